@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench_util.h"
+
+/*
+* Microbenchmark of pool_malloc_in/pool_free_in against the system malloc.
+* Every size class is measured at several fill levels, the share of the
+* pool's blocks already allocated and held while the operations run.
+* Four patterns are timed: alloc-only, free-only of those blocks, alloc/free
+* pairs and random-order churn over a working set.
+*
+* Build with `gcc -O2 bench.c pool_alloc.c -o bench` and run `./bench [blocks]`.
+*/
+
+#define DEFAULT_BLOCKS 65536 // blocks per size class and run
+#define CHURN_ROUNDS 4       // churn operations per block
+
+static const size_t g_sizes[] = {16, 32, 64, 128, 256, 512, 1024, 4096};
+static const int g_fill_levels[] = {0, 50, 90}; // percent of blocks held live
+
+/*
+ * This function prints one result line.
+ * Returns: No return value.
+ */
+static void report(const char* name, size_t size, int fill, const char* pattern,
+                   uint64_t elapsed, size_t ops)
+{
+    printf("%-7s %6zu %4d%% %-10s %10.2f %14.0f\n", name, size, fill, pattern,
+           ns_per_op(elapsed, ops), ops_per_sec(elapsed, ops));
+}
+
+/*
+ * This function runs every pattern for one size class and fill level.
+ * Each block is written once so neither allocator is timed on untouched memory.
+ * Returns: True - if every allocation succeeded, else - False
+ */
+static bool run_patterns(const backend* b, size_t size, int fill, size_t blocks, void** live, void** work)
+{
+    size_t held = blocks * (size_t)fill / 100;
+    size_t count = blocks - held;
+    uint64_t start;
+
+    for (size_t i = 0; i < held; ++i) {
+        if ((live[i] = b->alloc(b->ctx, size)) == NULL) {
+            return false;
+        }
+        *(volatile uint8_t*)live[i] = 1;
+    }
+
+    start = now_ns();
+    for (size_t i = 0; i < count; ++i) {
+        work[i] = b->alloc(b->ctx, size);
+        *(volatile uint8_t*)work[i] = 1;
+    }
+    report(b->name, size, fill, "alloc", now_ns() - start, count);
+
+    start = now_ns();
+    for (size_t i = 0; i < count; ++i) {
+        b->release(b->ctx, work[i]);
+    }
+    report(b->name, size, fill, "free", now_ns() - start, count);
+
+    start = now_ns();
+    for (size_t i = 0; i < count; ++i) {
+        void* ptr = b->alloc(b->ctx, size);
+        *(volatile uint8_t*)ptr = 1;
+        b->release(b->ctx, ptr);
+    }
+    report(b->name, size, fill, "pair", now_ns() - start, count * 2);
+
+    // random slots of the remaining blocks are allocated if empty, else freed
+    size_t slots = count / 2 != 0 ? count / 2 : 1;
+    size_t ops = count * CHURN_ROUNDS;
+    uint64_t state = 0x9E3779B97F4A7C15u ^ size;
+    memset(work, 0, slots * sizeof(void*));
+    start = now_ns();
+    for (size_t i = 0; i < ops; ++i) {
+        size_t slot = next_random(&state) % slots;
+        if (work[slot] == NULL) {
+            work[slot] = b->alloc(b->ctx, size);
+            *(volatile uint8_t*)work[slot] = 1;
+        }
+        else {
+            b->release(b->ctx, work[slot]);
+            work[slot] = NULL;
+        }
+    }
+    report(b->name, size, fill, "churn", now_ns() - start, ops);
+
+    for (size_t i = 0; i < slots; ++i) {
+        if (work[i] != NULL) {
+            b->release(b->ctx, work[i]);
+        }
+    }
+    for (size_t i = 0; i < held; ++i) {
+        b->release(b->ctx, live[i]);
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    size_t blocks = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_BLOCKS;
+    if (blocks == 0) {
+        fprintf(stderr, "usage: %s [blocks]\n", argv[0]);
+        return 1;
+    }
+
+    void** live = malloc(blocks * sizeof(void*));
+    void** work = malloc(blocks * sizeof(void*));
+    if (live == NULL || work == NULL) {
+        fprintf(stderr, "Err: Out of memory\n");
+        return 1;
+    }
+
+    printf("%-7s %6s %5s %-10s %10s %14s\n", "backend", "size", "fill", "pattern", "ns/op", "ops/sec");
+
+    for (size_t s = 0; s < sizeof(g_sizes) / sizeof(g_sizes[0]); ++s) {
+        size_t size = g_sizes[s];
+
+        // one pool sized to hold exactly the blocks of a run
+        pool_config config = {.block_sizes = &size, .block_size_count = 1, .block_counts = &blocks,
+                              .heap_size = blocks * size};
+        pool_t* pool = pool_create(&config);
+        if (pool == NULL) {
+            fprintf(stderr, "Err: Could not create a pool of %zu %zu-byte blocks\n", blocks, size);
+            return 1;
+        }
+
+        backend backends[2] = {
+            {"pool", pool_alloc_fn, pool_release_fn, pool},
+            {"malloc", malloc_fn, free_fn, NULL},
+        };
+
+        for (size_t f = 0; f < sizeof(g_fill_levels) / sizeof(g_fill_levels[0]); ++f) {
+            for (size_t b = 0; b < 2; ++b) {
+                if (!run_patterns(&backends[b], size, g_fill_levels[f], blocks, live, work)) {
+                    fprintf(stderr, "Err: %s ran out of memory\n", backends[b].name);
+                    return 1;
+                }
+            }
+        }
+        pool_destroy(pool);
+    }
+
+    free(live);
+    free(work);
+    return 0;
+}
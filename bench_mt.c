@@ -0,0 +1,397 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include "bench_util.h"
+
+/*
+* Multithreaded scalability benchmark of the thread-safe allocator against
+* the system malloc, in the style of larson and threadtest. For 1 up to the
+* given number of threads it runs two workloads:
+*   churn - every thread frees and replaces random blocks of its own set
+*   xfree - threads pair up, one allocates and hands blocks over a ring to
+*           the other, which frees them, so every free is cross-thread
+* and reports throughput, speedup over one thread, and p50/p99/p999
+* latency of single operations. Only one operation in LATENCY_SAMPLE is
+* timed, so reading the clock barely weighs on the throughput. Sizes are
+* drawn from a range with -d: uniform, geometric, where each doubling
+* above the smallest size is half as likely as the one before, like the
+* small-object mix of real programs, or fixed, the powers of two in the
+* range. Every random sequence is seeded, so runs are reproducible.
+*
+* Build with `gcc -O2 -DPOOL_THREAD_SAFE -pthread bench_mt.c pool_alloc.c -o bench_mt`
+* and run `./bench_mt [-t threads] [-n ops] [-s min:max] [-d uniform|geometric|fixed] [-r seed]`.
+*/
+
+#ifndef POOL_THREAD_SAFE
+#error "bench_mt.c measures the thread-safe allocator, build with -DPOOL_THREAD_SAFE -pthread"
+#endif
+
+#define MAX_THREADS 64
+#define WORKING_SET 1024    // live blocks per churn thread
+#define RING_SIZE 1024      // blocks in flight between a producer and its consumer
+#define LATENCY_SAMPLE 64   // one operation in this many is timed
+
+// how request sizes are spread over their range
+enum {
+    DIST_UNIFORM,
+    DIST_GEOMETRIC,
+    DIST_FIXED,
+    DIST_COUNT
+};
+
+static const char* const g_distribution_names[DIST_COUNT] = {"uniform", "geometric", "fixed"};
+
+// request sizes drawn by every thread
+typedef struct {
+    int distribution;        // one of the DIST_ values
+    size_t min_size;
+    size_t max_size;
+    size_t fixed_first;      // smallest power of two in the range
+    size_t fixed_count;      // powers of two in the range
+} size_mix;
+
+// single-producer single-consumer ring of blocks
+typedef struct {
+    void* slot[RING_SIZE];
+    _Alignas(64) _Atomic size_t head; // next slot the producer writes
+    _Alignas(64) _Atomic size_t tail; // next slot the consumer reads
+} ring;
+
+// parameters and results of one thread
+typedef struct {
+    const backend* b;
+    size_t ops;
+    const size_mix* sizes;
+    uint64_t seed;
+    ring* link;              // ring shared with the partner in xfree, else NULL
+    bool producer;
+    uint32_t* latency;       // nanoseconds of every timed operation
+    size_t timed;            // entries written to latency
+    size_t done;             // operations performed, timed or not
+    uint64_t begin;          // clock reading once the thread passed the barrier
+    uint64_t end;            // clock reading after its last measured operation
+    pthread_barrier_t* start;
+} worker;
+
+/*
+ * This function draws a request size from the worker's size mix. A
+ * geometric draw takes one more doubling above the smallest size for every
+ * low bit of the random value that is set, then a size within it.
+ * Returns: Size in bytes
+ */
+static size_t next_size(worker* w, uint64_t* state)
+{
+    const size_mix* sizes = w->sizes;
+    uint64_t r = next_random(state);
+    switch (sizes->distribution) {
+    case DIST_GEOMETRIC: {
+        size_t low = sizes->min_size;
+        while ((r & 1) != 0 && low <= sizes->max_size >> 1) {
+            low <<= 1;
+            r >>= 1;
+        }
+        size_t high = low <= sizes->max_size >> 1 ? 2 * low - 1 : sizes->max_size;
+        return low + (r >> 1) % (high - low + 1);
+    }
+    case DIST_FIXED:
+        return sizes->fixed_first << (r % sizes->fixed_count);
+    default:
+        return sizes->min_size + r % (sizes->max_size - sizes->min_size + 1);
+    }
+}
+
+/*
+ * This function allocates one block and, for sampled operations, records
+ * how long it took.
+ * Returns: Pointer to the block, the benchmark stops on failure
+ */
+static void* timed_alloc(worker* w, size_t n)
+{
+    void* ptr;
+    if (w->done++ % LATENCY_SAMPLE == 0) {
+        uint64_t start = now_ns();
+        ptr = w->b->alloc(w->b->ctx, n);
+        w->latency[w->timed++] = (uint32_t)(now_ns() - start);
+    }
+    else {
+        ptr = w->b->alloc(w->b->ctx, n);
+    }
+    if (ptr == NULL) {
+        fprintf(stderr, "Err: %s ran out of memory\n", w->b->name);
+        exit(1);
+    }
+    *(volatile uint8_t*)ptr = 1;
+    return ptr;
+}
+
+/*
+ * This function frees one block and, for sampled operations, records how
+ * long it took.
+ * Returns: No return value.
+ */
+static void timed_free(worker* w, void* ptr)
+{
+    if (w->done++ % LATENCY_SAMPLE == 0) {
+        uint64_t start = now_ns();
+        w->b->release(w->b->ctx, ptr);
+        w->latency[w->timed++] = (uint32_t)(now_ns() - start);
+    }
+    else {
+        w->b->release(w->b->ctx, ptr);
+    }
+}
+
+/*
+ * Churn workload, each operation frees a random block of the thread's
+ * working set and allocates its replacement.
+ * Returns: NULL
+ */
+static void* churn_thread(void* arg)
+{
+    worker* w = arg;
+    uint64_t state = w->seed;
+    void* set[WORKING_SET];
+
+    for (size_t i = 0; i < WORKING_SET; ++i) {
+        set[i] = w->b->alloc(w->b->ctx, next_size(w, &state));
+        if (set[i] == NULL) {
+            fprintf(stderr, "Err: %s ran out of memory\n", w->b->name);
+            exit(1);
+        }
+    }
+    pthread_barrier_wait(w->start);
+    w->begin = now_ns();
+
+    for (size_t i = 0; i < w->ops / 2; ++i) {
+        size_t slot = next_random(&state) % WORKING_SET;
+        timed_free(w, set[slot]);
+        set[slot] = timed_alloc(w, next_size(w, &state));
+    }
+    w->end = now_ns();
+
+    for (size_t i = 0; i < WORKING_SET; ++i) {
+        w->b->release(w->b->ctx, set[i]);
+    }
+    return NULL;
+}
+
+/*
+ * Cross-thread workload, the producer allocates blocks into the ring and
+ * the consumer frees them, yielding while the ring is full or empty.
+ * Returns: NULL
+ */
+static void* xfree_thread(void* arg)
+{
+    worker* w = arg;
+    uint64_t state = w->seed;
+    ring* link = w->link;
+    size_t blocks = w->ops;
+
+    pthread_barrier_wait(w->start);
+    w->begin = now_ns();
+
+    for (size_t i = 0; i < blocks; ++i) {
+        if (w->producer) {
+            void* ptr = timed_alloc(w, next_size(w, &state));
+            while (atomic_load_explicit(&link->head, memory_order_relaxed)
+                   - atomic_load_explicit(&link->tail, memory_order_acquire) == RING_SIZE) {
+                sched_yield(); // threads may outnumber cores
+            }
+            link->slot[i % RING_SIZE] = ptr;
+            atomic_store_explicit(&link->head, i + 1, memory_order_release);
+        }
+        else {
+            while (atomic_load_explicit(&link->head, memory_order_acquire) == i) {
+                sched_yield();
+            }
+            void* ptr = link->slot[i % RING_SIZE];
+            atomic_store_explicit(&link->tail, i + 1, memory_order_release);
+            timed_free(w, ptr);
+        }
+    }
+    w->end = now_ns();
+    return NULL;
+}
+
+static int compare_u32(const void* a, const void* b)
+{
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * This function runs one workload with a number of threads and prints its
+ * throughput and latency percentiles.
+ * Returns: Throughput in operations per second
+ */
+static double run(const backend* b, const char* workload, size_t threads, size_t ops,
+                  const size_mix* sizes, uint64_t seed, double base)
+{
+    pthread_t ids[MAX_THREADS];
+    worker workers[MAX_THREADS];
+    ring* rings = calloc(threads / 2 + 1, sizeof(ring));
+    pthread_barrier_t start;
+    bool xfree = strcmp(workload, "xfree") == 0;
+
+    pthread_barrier_init(&start, NULL, (unsigned)threads + 1);
+    for (size_t i = 0; i < threads; ++i) {
+        workers[i] = (worker){.b = b, .ops = ops, .sizes = sizes,
+                              .seed = seed + i * 0x9E3779B97F4A7C15u, .start = &start,
+                              .link = xfree ? &rings[i / 2] : NULL, .producer = i % 2 == 0,
+                              .latency = malloc((ops / LATENCY_SAMPLE + 1) * sizeof(uint32_t))};
+        if (workers[i].latency == NULL) {
+            fprintf(stderr, "Err: Out of memory\n");
+            exit(1);
+        }
+        pthread_create(&ids[i], NULL, xfree ? xfree_thread : churn_thread, &workers[i]);
+    }
+
+    pthread_barrier_wait(&start);
+    for (size_t i = 0; i < threads; ++i) {
+        pthread_join(ids[i], NULL);
+    }
+
+    // the workers read the clock themselves, from the first one to start
+    // to the last one to finish, since main may only run after they did
+    uint64_t begin = workers[0].begin;
+    uint64_t end = workers[0].end;
+    size_t done = 0;
+    size_t total = 0;
+    for (size_t i = 0; i < threads; ++i) {
+        begin = workers[i].begin < begin ? workers[i].begin : begin;
+        end = workers[i].end > end ? workers[i].end : end;
+        done += workers[i].done;
+        total += workers[i].timed;
+    }
+    uint64_t elapsed = end - begin;
+
+    // percentiles over every sampled operation of every thread
+    uint32_t* all = malloc((total != 0 ? total : 1) * sizeof(uint32_t));
+    size_t at = 0;
+    for (size_t i = 0; i < threads; ++i) {
+        memcpy(all + at, workers[i].latency, workers[i].timed * sizeof(uint32_t));
+        at += workers[i].timed;
+        free(workers[i].latency);
+    }
+    qsort(all, total, sizeof(uint32_t), compare_u32);
+
+    double throughput = ops_per_sec(elapsed, done);
+    printf("%-7s %-6s %7zu %14.0f %8.2f %8u %8u %8u\n", b->name, workload, threads, throughput,
+           base != 0.0 ? throughput / base : 1.0, total != 0 ? all[total / 2] : 0,
+           total != 0 ? all[total * 99 / 100] : 0, total != 0 ? all[total * 999 / 1000] : 0);
+
+    free(all);
+    free(rings);
+    pthread_barrier_destroy(&start);
+    return throughput;
+}
+
+int main(int argc, char** argv)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t max_threads = cpus < 1 ? 1 : cpus > MAX_THREADS ? MAX_THREADS : (size_t)cpus;
+    size_t ops = 200000;
+    size_t min_size = 16;
+    size_t max_size = 256;
+    int distribution = DIST_UNIFORM;
+    uint64_t seed = 42;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:n:s:d:r:")) != -1) {
+        switch (opt) {
+        case 't':
+            max_threads = strtoul(optarg, NULL, 10);
+            break;
+        case 'n':
+            ops = strtoul(optarg, NULL, 10);
+            break;
+        case 's':
+            if (sscanf(optarg, "%zu:%zu", &min_size, &max_size) != 2) {
+                min_size = max_size = strtoul(optarg, NULL, 10);
+            }
+            break;
+        case 'd':
+            distribution = 0;
+            while (distribution < DIST_COUNT && strcmp(optarg, g_distribution_names[distribution]) != 0) {
+                distribution++;
+            }
+            break;
+        case 'r':
+            seed = strtoull(optarg, NULL, 10);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-t threads] [-n ops] [-s min:max] [-d uniform|geometric|fixed] [-r seed]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (max_threads == 0 || max_threads > MAX_THREADS || ops == 0 || min_size == 0
+        || max_size < min_size || distribution == DIST_COUNT || seed == 0) {
+        fprintf(stderr, "Err: Invalid parameters\n");
+        return 1;
+    }
+
+    size_mix sizes = {.distribution = distribution, .min_size = min_size, .max_size = max_size, .fixed_first = 1};
+    while (sizes.fixed_first < min_size) {
+        sizes.fixed_first <<= 1;
+    }
+    for (size_t size = sizes.fixed_first; size <= max_size && size != 0; size <<= 1) {
+        sizes.fixed_count++;
+    }
+    if (distribution == DIST_FIXED && sizes.fixed_count == 0) {
+        fprintf(stderr, "Err: No power of two between %zu and %zu bytes\n", min_size, max_size);
+        return 1;
+    }
+
+    // size classes up to the largest request, growing on demand
+    size_t block_sizes[] = {16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192, 16384, 32768, 65536};
+    size_t count = 1;
+    while (count < sizeof(block_sizes) / sizeof(block_sizes[0]) && block_sizes[count - 1] < max_size) {
+        count++;
+    }
+    if (block_sizes[count - 1] < max_size) {
+        fprintf(stderr, "Err: Sizes above %zu bytes are not pooled\n", block_sizes[count - 1]);
+        return 1;
+    }
+    pool_config config = {.block_sizes = block_sizes, .block_size_count = count,
+                          .heap_size = count * 65536, .chunk_size = 65536, .grow_limit = (size_t)16 << 30};
+    pool_t* pool = pool_create(&config);
+    if (pool == NULL) {
+        fprintf(stderr, "Err: Could not create the pool\n");
+        return 1;
+    }
+
+    backend backends[2] = {
+        {"pool", pool_alloc_fn, pool_release_fn, pool},
+        {"malloc", malloc_fn, free_fn, NULL},
+    };
+    const char* workloads[2] = {"churn", "xfree"};
+
+    printf("sizes %zu..%zu bytes %s, %zu ops per thread, seed %llu\n", min_size, max_size,
+           g_distribution_names[distribution], ops, (unsigned long long)seed);
+    printf("%-7s %-6s %7s %14s %8s %8s %8s %8s\n", "backend", "load", "threads", "ops/sec",
+           "speedup", "p50 ns", "p99 ns", "p999 ns");
+
+    for (size_t w = 0; w < 2; ++w) {
+        for (size_t b = 0; b < 2; ++b) {
+            double base = 0.0;
+            // xfree needs whole producer/consumer pairs
+            for (size_t t = w == 1 ? 2 : 1; t <= max_threads; t += w == 1 ? 2 : 1) {
+                double throughput = run(&backends[b], workloads[w], t, ops, &sizes, seed, base);
+                if (base == 0.0) {
+                    base = throughput;
+                }
+            }
+        }
+    }
+
+    pool_destroy(pool);
+    return 0;
+}
@@ -0,0 +1,152 @@
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <list>
+#include <map>
+#include <memory_resource>
+#include <vector>
+#include "pool_resource.hpp"
+#include "bench_util.h"
+
+/*
+ * Benchmark of pool_memory_resource against the standard library's
+ * std::pmr::unsynchronized_pool_resource and new_delete_resource. Each
+ * resource backs the same std::pmr containers: a list filled and cleared,
+ * a map filled and emptied in random order, and random-order churn of map
+ * entries over a working set. A fresh resource is used for every pattern
+ * so none starts with memory another pattern released.
+ *
+ * Build with `gcc -O2 -c pool_alloc.c && g++ -O2 -std=c++17 bench_pmr.cpp pool_alloc.o -o bench_pmr`
+ * and run `./bench_pmr [ops]`.
+ */
+
+#define DEFAULT_OPS 1000000 // container operations per pattern
+#define CHURN_ROUNDS 4      // churn operations per working set entry
+
+/*
+ * This function prints one result line.
+ * Returns: No return value.
+ */
+static void report(const char* name, const char* pattern, uint64_t elapsed, size_t ops)
+{
+    printf("%-10s %-6s %10.2f %14.0f\n", name, pattern, ns_per_op(elapsed, ops), ops_per_sec(elapsed, ops));
+}
+
+// resource under test, make creates a fresh one for every pattern
+struct resource_backend {
+    const char* name;
+    std::pmr::memory_resource* (*make)(pool_t* pool);
+};
+
+static std::pmr::memory_resource* make_pool(pool_t* pool)
+{
+    return new pool_memory_resource(pool, std::pmr::new_delete_resource());
+}
+
+static std::pmr::memory_resource* make_std_pool(pool_t* pool)
+{
+    (void)pool;
+    return new std::pmr::unsynchronized_pool_resource();
+}
+
+static std::pmr::memory_resource* make_new_delete(pool_t* pool)
+{
+    (void)pool;
+    return nullptr; // new_delete_resource is a singleton
+}
+
+/*
+ * This function runs every pattern against one resource.
+ * Returns: No return value.
+ */
+static void run_patterns(const resource_backend& b, pool_t* pool, size_t ops, const std::vector<uint32_t>& keys)
+{
+    uint64_t start;
+    std::pmr::memory_resource* resource;
+
+    resource = b.make(pool);
+    {
+        std::pmr::list<uint64_t> values(resource != nullptr ? resource : std::pmr::new_delete_resource());
+        start = now_ns();
+        for (size_t i = 0; i < ops; ++i) {
+            values.push_back(i);
+        }
+        values.clear();
+        report(b.name, "list", now_ns() - start, ops * 2);
+    }
+    delete resource;
+
+    resource = b.make(pool);
+    {
+        std::pmr::map<uint32_t, uint64_t> table(resource != nullptr ? resource : std::pmr::new_delete_resource());
+        start = now_ns();
+        for (size_t i = 0; i < ops; ++i) {
+            table.emplace(keys[i], i);
+        }
+        for (size_t i = ops; i-- > 0;) {
+            table.erase(keys[i]);
+        }
+        report(b.name, "map", now_ns() - start, ops * 2);
+    }
+    delete resource;
+
+    // random keys of a working set are inserted if absent, else erased
+    resource = b.make(pool);
+    {
+        std::pmr::map<uint32_t, uint64_t> table(resource != nullptr ? resource : std::pmr::new_delete_resource());
+        size_t slots = ops / CHURN_ROUNDS != 0 ? ops / CHURN_ROUNDS : 1;
+        uint64_t state = 0x9E3779B97F4A7C15u;
+        start = now_ns();
+        for (size_t i = 0; i < ops; ++i) {
+            uint32_t key = (uint32_t)(next_random(&state) % slots);
+            if (table.erase(key) == 0) {
+                table.emplace(key, i);
+            }
+        }
+        report(b.name, "churn", now_ns() - start, ops);
+    }
+    delete resource;
+}
+
+int main(int argc, char** argv)
+{
+    size_t ops = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_OPS;
+    if (ops == 0) {
+        fprintf(stderr, "usage: %s [ops]\n", argv[0]);
+        return 1;
+    }
+
+    // list and map nodes are 32 to 48 bytes, the rest covers small containers
+    const size_t block_sizes[] = {16, 32, 48, 64, 128, 256};
+    pool_config config = {};
+    config.block_sizes = block_sizes;
+    config.block_size_count = sizeof(block_sizes) / sizeof(block_sizes[0]);
+    config.heap_size = config.block_size_count * 65536;
+    config.chunk_size = 65536;
+    config.grow_limit = (size_t)16 << 30;
+    pool_t* pool = pool_create(&config);
+    if (pool == NULL) {
+        fprintf(stderr, "Err: Could not create a pool\n");
+        return 1;
+    }
+
+    std::vector<uint32_t> keys(ops);
+    uint64_t state = 0x2545F4914F6CDD1Du;
+    for (size_t i = 0; i < ops; ++i) {
+        keys[i] = (uint32_t)next_random(&state);
+    }
+
+    const resource_backend backends[] = {
+        {"pool", make_pool},
+        {"std_pool", make_std_pool},
+        {"new_delete", make_new_delete},
+    };
+
+    printf("%-10s %-6s %10s %14s\n", "resource", "test", "ns/op", "ops/sec");
+    for (const resource_backend& b : backends) {
+        run_patterns(b, pool, ops, keys);
+    }
+
+    pool_destroy(pool);
+    return 0;
+}
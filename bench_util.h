@@ -0,0 +1,86 @@
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include "pool_alloc.h"
+
+/*
+* Helpers shared by the benchmarks and the trace replay: the clock, the
+* seeded random generator, the pool and system malloc backends and the
+* per-operation figures they report. Everything is static inline so the
+* header builds as C and as C++.
+*/
+
+// allocator under test, either a pool instance or the system malloc
+typedef struct {
+    const char* name;
+    void* (*alloc)(void* ctx, size_t n);
+    void (*release)(void* ctx, void* ptr);
+    void* ctx;
+} backend;
+
+static inline void* pool_alloc_fn(void* ctx, size_t n)
+{
+    return pool_malloc_in((pool_t*)ctx, n);
+}
+
+static inline void pool_release_fn(void* ctx, void* ptr)
+{
+    pool_free_in((pool_t*)ctx, ptr);
+}
+
+static inline void* malloc_fn(void* ctx, size_t n)
+{
+    (void)ctx;
+    return malloc(n);
+}
+
+static inline void free_fn(void* ctx, void* ptr)
+{
+    (void)ctx;
+    free(ptr);
+}
+
+/*
+ * This function reads a monotonic clock.
+ * Returns: Current time in nanoseconds
+ */
+static inline uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * This function advances a xorshift generator, fixed seeds keep runs comparable.
+ * Returns: Next pseudo-random value
+ */
+static inline uint64_t next_random(uint64_t* state)
+{
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+/*
+ * These functions turn the time taken by ops operations into the figures
+ * printed on a result line.
+ * Returns: Nanoseconds per operation, or operations per second, 0 if undefined
+ */
+static inline double ns_per_op(uint64_t elapsed, size_t ops)
+{
+    return ops != 0 ? (double)elapsed / (double)ops : 0.0;
+}
+
+static inline double ops_per_sec(uint64_t elapsed, size_t ops)
+{
+    return elapsed != 0 ? (double)ops * 1e9 / (double)elapsed : 0.0;
+}
+
+#endif // BENCH_UTIL_H
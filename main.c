@@ -1,7 +1,12 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 #include "pool_alloc.h"
+#ifdef POOL_THREAD_SAFE
+#include <pthread.h>
+#include <stdatomic.h>
+#endif
 
 /*
  * This file tests the functionality defined in pool_alloc.h and implemented
@@ -19,10 +24,260 @@ const char* passed(int ret, int expected) {
   }
 }
 
+#ifdef POOL_THREAD_SAFE
+// state shared with the helper thread of test 31
+static pool_t* g_mt_pool;
+static pthread_barrier_t g_mt_barrier;
+static void* g_mt_blocks[16];
+static size_t g_mt_count;
+
+/*
+ * Helper thread of test 31. It leaves blocks of the 1024-byte pool in its
+ * cache while main exhausts that pool, then takes every block main freed.
+ */
+static void* mt_helper(void* arg)
+{
+  (void)arg;
+  pool_free_in(g_mt_pool, pool_malloc_in(g_mt_pool, 1000));
+  pthread_barrier_wait(&g_mt_barrier);
+
+  pthread_barrier_wait(&g_mt_barrier);
+  while (g_mt_count < 16 && (g_mt_blocks[g_mt_count] = pool_malloc_in(g_mt_pool, 1000)) != NULL) {
+    g_mt_count++;
+  }
+  pthread_barrier_wait(&g_mt_barrier);
+  return NULL;
+}
+
+#define STRESS_THREADS 4
+#define STRESS_SLOTS 64
+
+// parameters of one stress thread of tests 32 and 33
+typedef struct {
+  pool_t* pool;              // instance under test, NULL for the default instance
+  uint32_t seed;
+  int ops;
+  bool pause;                // park halfway through at g_stress_barrier
+} stress_arg;
+
+// blocks passed between the stress threads, each is freed by whichever thread takes it out
+static void* _Atomic g_stress_slots[STRESS_SLOTS];
+static atomic_int g_stress_errors;
+static atomic_int g_stress_allocated;
+static pthread_barrier_t g_stress_barrier; // parks the threads while main changes the instance
+static bool g_stress_resume;               // threads carry on after the pause
+
+static void* stress_malloc(pool_t* pool, size_t n)
+{
+  return pool != NULL ? pool_malloc_in(pool, n) : pool_malloc(n);
+}
+
+static void stress_free(pool_t* pool, void* ptr)
+{
+  if (pool != NULL){
+    pool_free_in(pool, ptr);
+  }
+  else {
+    pool_free(ptr);
+  }
+}
+
+/*
+ * This function checks that a block handed over between stress threads
+ * still holds the pattern written when it was allocated and belongs to
+ * the pool. Another live block overlapping it would have overwritten it.
+ * Returns: True - if the block is intact, else - False
+ */
+static bool stress_intact(pool_t* pool, const uint8_t* block)
+{
+  size_t n;
+  memcpy(&n, block, sizeof(n));
+  size_t usable = pool != NULL ? pool_usable_size_in(pool, block) : pool_usable_size(block);
+  if (n < sizeof(n) || usable < n){
+    return false;
+  }
+  for (size_t i = sizeof(n); i < n; i++){
+    if (block[i] != (uint8_t)((uintptr_t)block >> 3)){
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * Stress thread of tests 32 and 33. Every operation allocates a block,
+ * fills it with a pattern of its address, and swaps it into a random slot,
+ * freeing the block it displaced, most often allocated by another thread.
+ * A pausing thread parks halfway with blocks still in its cache.
+ */
+static void* stress_thread(void* arg)
+{
+  stress_arg* params = arg;
+  static const size_t sizes[4] = {24, 60, 200, 900};
+  uint32_t state = params->seed;
+
+  for (int i = 0; i < params->ops; i++){
+    if (params->pause && i == params->ops / 2){
+      pthread_barrier_wait(&g_stress_barrier);
+      pthread_barrier_wait(&g_stress_barrier);
+      if (!g_stress_resume){
+        return NULL;
+      }
+    }
+    state = state * 1103515245u + 12345u;
+    size_t n = sizes[(state >> 16) % 4];
+    uint8_t* block = stress_malloc(params->pool, n);
+    if (block != NULL){
+      atomic_fetch_add(&g_stress_allocated, 1);
+      memcpy(block, &n, sizeof(n));
+      memset(block + sizeof(n), (uint8_t)((uintptr_t)block >> 3), n - sizeof(n));
+    }
+
+    uint8_t* taken = atomic_exchange(&g_stress_slots[(state >> 8) % STRESS_SLOTS], block);
+    if (taken != NULL){
+      if (!stress_intact(params->pool, taken)){
+        atomic_fetch_add(&g_stress_errors, 1);
+      }
+      stress_free(params->pool, taken);
+    }
+  }
+  return NULL;
+}
+
+/*
+ * This function frees the blocks the stress threads left in the slots.
+ * Returns: No return value.
+ */
+static void stress_drain(pool_t* pool)
+{
+  for (int i = 0; i < STRESS_SLOTS; i++){
+    uint8_t* left = atomic_exchange(&g_stress_slots[i], NULL);
+    if (left != NULL){
+      if (!stress_intact(pool, left)){
+        atomic_fetch_add(&g_stress_errors, 1);
+      }
+      stress_free(pool, left);
+    }
+  }
+}
+
+/*
+ * This function runs the stress threads of tests 32 and 33 on one
+ * instance and frees the blocks they left in the slots. Given a pause
+ * callback, the threads park halfway, the slots are drained and the
+ * callback runs alone, its result deciding whether the threads go on.
+ * Returns: True - if every block came back intact, else - False
+ */
+static bool stress_run(pool_t* pool, int ops, bool (*paused)(pool_t* pool))
+{
+  pthread_t threads[STRESS_THREADS];
+  stress_arg params[STRESS_THREADS];
+
+  atomic_store(&g_stress_errors, 0);
+  atomic_store(&g_stress_allocated, 0);
+  if (paused != NULL){
+    pthread_barrier_init(&g_stress_barrier, NULL, STRESS_THREADS + 1);
+  }
+  for (int i = 0; i < STRESS_THREADS; i++){
+    params[i] = (stress_arg){pool, 2654435761u * (uint32_t)(i + 1), ops, paused != NULL};
+    if (pthread_create(&threads[i], NULL, stress_thread, &params[i]) != 0){
+      return false;
+    }
+  }
+
+  if (paused != NULL){
+    pthread_barrier_wait(&g_stress_barrier);
+    stress_drain(pool);
+    g_stress_resume = paused(pool);
+    pthread_barrier_wait(&g_stress_barrier);
+  }
+  for (int i = 0; i < STRESS_THREADS; i++){
+    pthread_join(threads[i], NULL);
+  }
+  if (paused != NULL){
+    pthread_barrier_destroy(&g_stress_barrier);
+  }
+
+  if (paused == NULL || g_stress_resume){
+    stress_drain(pool);
+  }
+  return atomic_load(&g_stress_errors) == 0 && atomic_load(&g_stress_allocated) > 0;
+}
+
+/*
+ * Pause callbacks of test 33. The first lays out the default instance
+ * again, so blocks cached by the parked threads belong to the old layout,
+ * the second destroys an instance whose threads still hold caches.
+ * Returns: True if the threads carry on with the instance
+ */
+static bool stress_relayout(pool_t* pool)
+{
+  (void)pool;
+  size_t relayout_block[4] = {48, 128, 512, 2048};
+  return pool_init(relayout_block, 4);
+}
+
+static bool stress_destroy(pool_t* pool)
+{
+  pool_destroy(pool);
+  return false;
+}
+
+/*
+ * This function counts the 1000-byte blocks the calling thread can take
+ * from an instance with 1024-byte blocks as its largest, then frees them.
+ * Returns: Number of blocks allocated
+ */
+static int stress_capacity(pool_t* pool)
+{
+  void* held[64];
+  int count = 0;
+  while (count < 64 && (held[count] = pool_malloc_in(pool, 1000)) != NULL){
+    count++;
+  }
+  for (int i = 0; i < count; i++){
+    pool_free_in(pool, held[i]);
+  }
+  return count;
+}
+#endif
+
 int main()
 {
   bool result;
 
+#ifdef POOL_STATIC_CONFIG
+  // Built with -DPOOL_STATIC_CONFIG='"static_pools.h"', the default instance
+  // is laid out at compile time so only its tests apply
+  printf("-------------------------");
+  printf("\nStatic Configuration Tests\n");
+
+  // Test case 30: Allocation works without any initialization call
+  void* static_block = pool_malloc(20);
+  printf("\nTest Case 30a: %s", passed(static_block != NULL && pool_usable_size(static_block) == 32, 1));
+
+  // The size class is a compile-time constant and the layout cannot change
+  printf("\nTest Case 30b: %s", passed(pool_static_class(20, 1) == 0 && pool_static_class(65, 8) == 2
+                                        && pool_static_class(1025, 1) == POOL_STATIC_COUNT
+                                        && pool_static_class(20, 64) == 1 && pool_static_class(20, 3) == POOL_STATIC_COUNT, 1));
+  size_t other_block[2] = {32, 64};
+  printf("\nTest Case 30c: %s", passed(pool_init(other_block, 2), 0));
+
+  // Each pool holds exactly its configured block count
+  void* largest[17];
+  size_t taken = 0;
+  while (taken < 17 && (largest[taken] = pool_malloc_class(pool_static_class(1000, 1))) != NULL) {
+    taken++;
+  }
+  printf("\nTest Case 30d: %s", passed(taken == 16, 1));
+  while (taken > 0) {
+    pool_free_class(pool_static_class(1000, 1), largest[--taken]);
+  }
+  pool_free(static_block);
+  printf("\nTest Case 30e: %s", passed(pool_malloc(20) == static_block, 1));
+  return 0;
+#endif
+
   printf("-------------------------");
   printf("\nInitialization Tests\n\n");
   
@@ -35,15 +290,18 @@ int main()
   result = pool_init(invalid_block1, 2);
   printf("\nTest Case 1b: %s", passed(result, 0));
 
-  // Test case 2: Number of block sizes is greater than limit (currently 5 pools)
-  size_t invalid_block2[6] = {32, 64, 256, 1024, 2048, 4096};
-  result = pool_init(invalid_block2, 6);
+  // Test case 2: Number of block sizes is greater than limit (currently 32 pools)
+  size_t invalid_block2[33];
+  for (int i = 0; i < 33; i++){
+    invalid_block2[i] = 16 * (i + 1);
+  }
+  result = pool_init(invalid_block2, 33);
   printf("\nTest Case 2: %s", passed(result, 0));
 
   // Test case 3: Block size greater than partition size
   size_t valid_block[5] = {32, 64, 256, 1024, 14000};
   result = pool_init(valid_block, 5);
-  // Partition = 65536 / 5 -> 13107
+  // Partition = 65536 / 5 -> 13107, rounded down to 13056
   printf("\nTest Case 3: %s", passed(result, 0));
 
   // Test case 4: Successful initialization of allocator
@@ -159,5 +417,498 @@ int main()
   }
   // Allocation fails after all blocks have been allocated and there are no freed list nodes
 
+  printf("\n-------------------------");
+  printf("\nSize Class Tests\n");
+
+  // Test 11: Dozens of unsorted size classes still resolve to the best fit
+  size_t many_block[24];
+  for (int i = 0; i < 24; i++){
+    many_block[i] = 24 * (24 - i); // 576 down to 24, none a power of two
+  }
+  result = pool_init(many_block, 24);
+  void* small = pool_malloc(47);
+  void* exact = pool_malloc(48);
+  void* above = pool_malloc(49);
+  // 47 and 48 share the 48-byte pool, 49 moves up to the 72-byte pool
+  // Partition = 65536 / 24 -> 2730, rounded down to 2560 (53 48-byte blocks)
+  if (result && (char*)exact - (char*)small == 48 && above != NULL
+      && (char*)above >= (char*)small + 53 * 48){
+    printf("\nTest Case 11: Test Passed\n");
+  }
+  else {
+    printf("\nTest Case 11: Test Failed\n");
+  }
+
+  // Test 12: Pointers outside of the pools are ignored by pool_free
+  long foreign = 0;
+  pool_free(&foreign);
+  pool_free(above);
+  void* reused = pool_malloc(49);
+  printf("\nTest Case 12a: %s", passed(reused == above, 1));
+
+  // Pointers into the middle of a block are rejected by every free call
+  char* whole = pool_malloc(49);
+  pool_free(whole + 8);
+  pool_free_sized(whole + 24, 49);
+  pool_free_class(pool_size_class(49, 1), whole + 48);
+  bool interior_kept = !pool_try_free(whole + 1) && pool_usable_size(whole + 8) == 0;
+  void* after = pool_malloc(49);
+  printf("\nTest Case 12b: %s", passed(interior_kept && whole != NULL && after != NULL
+                                        && after != whole + 8 && after != whole + 24 && after != whole + 48, 1));
+
+  // Also in blocks of growth chunks
+  size_t odd_block[1] = {48};
+  pool_config odd_config = {.block_sizes = odd_block, .block_size_count = 1, .heap_size = 4096, .chunk_size = 4096};
+  pool_t* odd_pool = pool_create(&odd_config);
+  char* chunk_block = NULL;
+  for (int i = 0; i < 100; i++){
+    chunk_block = pool_malloc_in(odd_pool, 48); // 85 blocks fit the heap, the rest a chunk
+  }
+  printf("\nTest Case 12c: %s", passed(chunk_block != NULL && !pool_try_free_in(odd_pool, chunk_block + 16)
+                                        && pool_try_free_in(odd_pool, chunk_block), 1));
+  pool_destroy(odd_pool);
+
+  printf("\n-------------------------");
+  printf("\nInstance Tests\n");
+
+  // Test 13: Instances are isolated from each other and from pool_init
+  size_t inst_block[2] = {64, 512};
+  pool_config config = {.block_sizes = inst_block, .block_size_count = 2};
+  pool_t* first = pool_create(&config);
+  pool_t* second = pool_create(&config);
+  void* from_first = pool_malloc_in(first, 40);
+  pool_free_in(second, from_first); // not owned by second, ignored
+  void* from_second = pool_malloc_in(second, 40);
+  pool_init(block, 4);
+  pool_free_in(first, from_first);
+  printf("\nTest Case 13: %s", passed(from_first != NULL && from_second != NULL
+      && from_first != from_second && pool_malloc_in(first, 40) == from_first, 1));
+  pool_destroy(first);
+  pool_destroy(second);
+
+  // Test 14: Instance creation fails on an invalid configuration
+  config.block_size_count = 0;
+  printf("\nTest Case 14: %s", passed(pool_create(&config) == NULL, 1));
+
+  // Test 15: Caller-provided buffer, trimmed to whole 256-byte pages
+  static char buffer[8192 + 100];
+  pool_config buffer_config = {.block_sizes = inst_block, .block_size_count = 2,
+                               .heap = buffer + 100, .heap_size = 8192};
+  pool_t* in_buffer = pool_create(&buffer_config);
+  char* block_ptr = pool_malloc_in(in_buffer, 500);
+  printf("\nTest Case 15: %s", passed(block_ptr >= buffer + 100
+      && block_ptr + 512 <= buffer + sizeof(buffer), 1));
+  pool_destroy(in_buffer);
+
+  // Test 16: Mapped heap sized at runtime holds blocks far beyond 64 KiB
+  size_t large_block[2] = {64, 256 * 1024};
+  pool_config mapped_config = {.block_sizes = large_block, .block_size_count = 2,
+                               .heap_size = 4 * 1024 * 1024};
+  pool_t* mapped = pool_create(&mapped_config);
+  int large_count = 0;
+  while (pool_malloc_in(mapped, 200 * 1024) != NULL){
+    large_count++;
+  }
+  // Partition = 4 MiB / 2 -> 2 MiB, eight 256 KiB blocks
+  printf("\nTest Case 16: %s", passed(large_count, 8));
+  pool_destroy(mapped);
+
+  // Test 17: Pools with more than 65535 blocks do not wrap their counters
+  size_t tiny_block[1] = {8};
+  pool_config tiny_config = {.block_sizes = tiny_block, .block_size_count = 1,
+                             .heap_size = 1024 * 1024};
+  pool_t* tiny = pool_create(&tiny_config);
+  char* prev_block = NULL;
+  int tiny_count = 0;
+  bool ascending = true;
+  char* tiny_ptr;
+  while ((tiny_ptr = pool_malloc_in(tiny, 8)) != NULL){
+    ascending = ascending && tiny_ptr > prev_block;
+    prev_block = tiny_ptr;
+    tiny_count++;
+  }
+  // 1 MiB / 8 -> 131072 blocks, all distinct
+  printf("\nTest Case 17: %s", passed(ascending && tiny_count == 131072, 1));
+  pool_destroy(tiny);
+
+  printf("\n-------------------------");
+  printf("\nGrowth Tests\n");
+
+  // Test 18: A full pool maps new chunks instead of spilling or failing
+  size_t grow_block[2] = {64, 2048};
+  pool_config grow_config = {.block_sizes = grow_block, .block_size_count = 2,
+                             .heap_size = 8192, .chunk_size = 4096, .grow_limit = 64 * 1024};
+  pool_t* growing = pool_create(&grow_config);
+  int grow_count = 0;
+  void* last_grown = NULL;
+  // 4096-byte partition holds 64 blocks, then 16 chunks of 64 blocks each
+  for (int i = 0; i < 64 + 16 * 64; i++){
+    last_grown = pool_malloc_in(growing, 60);
+    grow_count += last_grown != NULL;
+  }
+  printf("\nTest Case 18a: %s", passed(grow_count, 64 + 16 * 64));
+
+  // Blocks from growth chunks are freed and reused like heap blocks
+  pool_free_in(growing, last_grown);
+  printf("\nTest Case 18b: %s", passed(pool_malloc_in(growing, 60) == last_grown, 1));
+
+  // Nothing spilled into the 2048-byte pool while the 64-byte pool could grow
+  void* big1 = pool_malloc_in(growing, 2000);
+  void* big2 = pool_malloc_in(growing, 2000);
+  printf("\nTest Case 18c: %s", passed(big1 != NULL && big2 != NULL, 1));
+  pool_destroy(growing);
+
+  printf("\n-------------------------");
+  printf("\nPartitioning Tests\n");
+
+  // Test 19: Weights split the heap in proportion to demand
+  size_t weighted_block[2] = {1024, 32};
+  size_t weights[2] = {1, 7};
+  pool_config weighted_config = {.block_sizes = weighted_block, .block_size_count = 2,
+                                 .block_weights = weights};
+  pool_t* weighted = pool_create(&weighted_config);
+  int weighted_count = 0;
+  while (pool_malloc_in(weighted, 32) != NULL){
+    weighted_count++;
+  }
+  // 256 pages * 7 / 8 -> 224 pages (1792 32-byte blocks), 32 pages (8 1024-byte blocks)
+  printf("\nTest Case 19: %s", passed(weighted_count, 1792 + 8));
+  pool_destroy(weighted);
+
+  // Test 20: Explicit counts reserve just the pages those blocks need
+  size_t counted_block[2] = {64, 1024};
+  size_t counts[2] = {128, 8};
+  pool_config counted_config = {.block_sizes = counted_block, .block_size_count = 2,
+                                .block_counts = counts};
+  pool_t* counted = pool_create(&counted_config);
+  int counted_count = 0;
+  while (pool_malloc_in(counted, 64) != NULL){
+    counted_count++;
+  }
+  printf("\nTest Case 20a: %s", passed(counted_count, 128 + 8));
+  pool_destroy(counted);
+
+  // More blocks than the heap holds is rejected
+  counts[0] = 2000;
+  printf("\nTest Case 20b: %s", passed(pool_create(&counted_config) == NULL, 1));
+
+  // Test 21: Slabs freed by one size class are taken over by another
+  size_t slab_block[2] = {64, 1024};
+  pool_config slab_config = {.block_sizes = slab_block, .block_size_count = 2,
+                             .heap_size = 65536, .slab_size = 4096};
+  pool_t* slabbed = pool_create(&slab_config);
+  static void* slab_ptrs[1024];
+  int slab_count = 0;
+  while (slab_count < 1024 && (slab_ptrs[slab_count] = pool_malloc_in(slabbed, 64)) != NULL){
+    slab_count++;
+  }
+  // all 16 slabs went to the 64-byte pool, leaving none for 1024-byte blocks
+  printf("\nTest Case 21a: %s", passed(slab_count + (pool_malloc_in(slabbed, 1000) != NULL), 1024));
+
+  // a slab moves over as soon as its last block is freed, even while the
+  // other slabs of its pool are still in use
+  for (int i = 0; i < 256; i++){
+    pool_free_in(slabbed, slab_ptrs[i]);
+  }
+  static void* moved_ptrs[16];
+  int moved_count = 0;
+  while (moved_count < 16 && (moved_ptrs[moved_count] = pool_malloc_in(slabbed, 1000)) != NULL){
+    moved_count++;
+  }
+  // up to two cache batches of the last slab may still be held in thread-safe builds
+  printf("\nTest Case 21b: %s", passed(moved_count >= 12, 1));
+  for (int i = 0; i < moved_count; i++){
+    pool_free_in(slabbed, moved_ptrs[i]);
+  }
+
+  for (int i = 256; i < slab_count; i++){
+    pool_free_in(slabbed, slab_ptrs[i]);
+  }
+  int reused_count = 0;
+  while (pool_malloc_in(slabbed, 1000) != NULL){
+    reused_count++;
+  }
+  // every slab but the one the 64-byte pool is still bumping through moves over
+  printf("\nTest Case 21c: %s", passed(reused_count, 15 * 4));
+  pool_destroy(slabbed);
+
+  // Released slabs next to each other are rejoined for blocks larger than a slab
+  size_t span_block[2] = {64, 8192};
+  pool_config span_config = {.block_sizes = span_block, .block_size_count = 2,
+                             .heap_size = 65536, .slab_size = 4096};
+  pool_t* spanned = pool_create(&span_config);
+  int span_counts[2] = {0, 0};
+  for (int round = 0; round < 2; round++){
+    int small_count = 0;
+    while (small_count < 1024 && (slab_ptrs[small_count] = pool_malloc_in(spanned, 64)) != NULL){
+      small_count++;
+    }
+    for (int i = 0; i < small_count; i++){
+      pool_free_in(spanned, slab_ptrs[i]);
+    }
+    while (span_counts[round] < 16 && (moved_ptrs[span_counts[round]] = pool_malloc_in(spanned, 8192)) != NULL){
+      span_counts[round]++;
+    }
+    for (int i = 0; i < span_counts[round]; i++){
+      pool_free_in(spanned, moved_ptrs[i]);
+    }
+  }
+  // every pair of slabs but the one the 64-byte pool is still bumping through, in both rounds
+  printf("\nTest Case 21e: %s", passed(span_counts[0] == 7 && span_counts[1] == 7, 1));
+  pool_destroy(spanned);
+
+  // Slabs replace fixed partitions, so they cannot be combined with them
+  counts[0] = 128;
+  slab_config.block_counts = counts;
+  printf("\nTest Case 21d: %s", passed(pool_create(&slab_config) == NULL, 1));
+
+  printf("\n-------------------------");
+  printf("\nBulk Tests\n");
+
+  // Test 22: Bulk calls hand out and take back whole bursts
+  size_t bulk_block[1] = {64};
+  pool_config bulk_config = {.block_sizes = bulk_block, .block_size_count = 1, .heap_size = 8192};
+  pool_t* bulk = pool_create(&bulk_config);
+  void* burst[200];
+  size_t burst_count = pool_malloc_bulk_in(bulk, 48, burst, 100);
+  int distinct = 1;
+  for (size_t i = 1; i < burst_count; i++){
+    distinct &= (uint8_t*)burst[i] - (uint8_t*)burst[i - 1] == 64;
+  }
+  printf("\nTest Case 22a: %s", passed(burst_count == 100 && distinct, 1));
+
+  // Freed bursts are reused, the rest of the heap fills a short burst
+  void* first_freed = burst[0];
+  pool_free_bulk_in(bulk, burst, burst_count);
+  burst_count = pool_malloc_bulk_in(bulk, 48, burst, 200);
+  int burst_reused = 0;
+  for (size_t i = 0; i < burst_count; i++){
+    burst_reused |= burst[i] == first_freed;
+  }
+  printf("\nTest Case 22b: %s", passed(burst_count == 128 && burst_reused, 1));
+  pool_destroy(bulk);
+
+  // Test 23: Sized frees return blocks to the pool they came from
+  size_t sized_block[2] = {32, 64};
+  size_t sized_counts[2] = {8, 8};
+  pool_config sized_config = {.block_sizes = sized_block, .block_size_count = 2,
+                              .block_counts = sized_counts};
+  pool_t* sized = pool_create(&sized_config);
+  void* sized_ptrs[9];
+  for (int i = 0; i < 9; i++){
+    sized_ptrs[i] = pool_malloc_in(sized, 30);
+  }
+  pool_free_sized_in(sized, sized_ptrs[0], 30);
+  printf("\nTest Case 23a: %s", passed(pool_malloc_in(sized, 30) == sized_ptrs[0], 1));
+
+  // The ninth block spilled into the 64-byte pool and goes back there
+  pool_free_sized_in(sized, sized_ptrs[8], 30);
+  printf("\nTest Case 23b: %s", passed(pool_malloc_in(sized, 60) == sized_ptrs[8], 1));
+  pool_destroy(sized);
+
+  // Test 24: Realloc grows in place until the block is full, then moves
+  size_t realloc_block[2] = {32, 128};
+  pool_config realloc_config = {.block_sizes = realloc_block, .block_size_count = 2};
+  pool_t* resizing = pool_create(&realloc_config);
+  char* text = pool_malloc_in(resizing, 10);
+  memcpy(text, "abcdefghi", 10);
+  printf("\nTest Case 24a: %s", passed(pool_realloc_in(resizing, text, 32) == text, 1));
+
+  char* moved = pool_realloc_in(resizing, text, 100);
+  printf("\nTest Case 24b: %s", passed(moved != text && strcmp(moved, "abcdefghi") == 0, 1));
+
+  // The old block went back to its pool in the same call
+  printf("\nTest Case 24c: %s", passed(pool_malloc_in(resizing, 20) == text, 1));
+  pool_destroy(resizing);
+
+  // Test 25: Aligned requests only use pools whose stride keeps the alignment
+  size_t aligned_block[3] = {24, 48, 64};
+  pool_config aligned_config = {.block_sizes = aligned_block, .block_size_count = 3};
+  pool_t* aligning = pool_create(&aligned_config);
+  pool_malloc_in(aligning, 40); // leaves the next 48-byte block only 16-byte aligned
+  void* line = pool_aligned_alloc_in(aligning, 64, 10);
+  void* vector = pool_aligned_alloc_in(aligning, 16, 20);
+  printf("\nTest Case 25a: %s", passed((uintptr_t)line % 64 == 0 && (uintptr_t)vector % 16 == 0
+                                        && pool_aligned_alloc_in(aligning, 32, 50) != NULL, 1));
+
+  // Alignments that are not a power of two, or larger than a page, are rejected
+  printf("\nTest Case 25b: %s", passed(pool_aligned_alloc_in(aligning, 24, 10) == NULL
+                                        && pool_aligned_alloc_in(aligning, 512, 10) == NULL, 1));
+  pool_destroy(aligning);
+
+  // Test 26: Calloc hands out zeroed memory, fresh or recycled
+  size_t zero_block[1] = {64};
+  pool_config zero_config = {.block_sizes = zero_block, .block_size_count = 1, .heap_size = 4096};
+  pool_t* zeroing = pool_create(&zero_config);
+  uint8_t* dirty = pool_calloc_in(zeroing, 6, 10);
+  int all_zero = dirty != NULL;
+  for (int i = 0; i < 60; i++){
+    all_zero &= dirty[i] == 0;
+  }
+  memset(dirty, 0xAB, 64);
+  pool_free_in(zeroing, dirty);
+  uint8_t* cleared = pool_calloc_in(zeroing, 1, 60);
+  for (int i = 0; i < 60; i++){
+    all_zero &= cleared[i] == 0;
+  }
+  printf("\nTest Case 26a: %s", passed(all_zero && cleared == dirty, 1));
+
+  // Sizes whose product overflows are rejected
+  printf("\nTest Case 26b: %s", passed(pool_calloc_in(zeroing, SIZE_MAX / 2, 4) == NULL, 1));
+  pool_destroy(zeroing);
+
+  // Test 26c: Recycled blocks left behind when a thread cache flushes are still cleared
+  size_t flush_block[1] = {64};
+  pool_config flush_config = {.block_sizes = flush_block, .block_size_count = 1, .heap_size = 65536};
+  pool_t* flushing = pool_create(&flush_config);
+  uint8_t* soiled[100];
+  for (int i = 0; i < 100; i++){
+    soiled[i] = pool_malloc_in(flushing, 64);
+    memset(soiled[i], 0xAB, 64);
+  }
+  for (int i = 0; i < 37; i++){
+    pool_free_in(flushing, soiled[i]);
+  }
+  int flushed_zero = 1;
+  for (int i = 0; i < 32; i++){
+    uint8_t* block = pool_calloc_in(flushing, 1, 64);
+    flushed_zero &= block != NULL;
+    for (int j = 0; block != NULL && j < 64; j++){
+      flushed_zero &= block[j] == 0;
+    }
+  }
+  printf("\nTest Case 26c: %s", passed(flushed_zero, 1));
+  pool_destroy(flushing);
+
+  // Test 27: Callers learn the full capacity of the block they were given
+  size_t slack_block[2] = {64, 256};
+  pool_config slack_config = {.block_sizes = slack_block, .block_size_count = 2};
+  pool_t* slack = pool_create(&slack_config);
+  size_t capacity = 0;
+  void* roomy = pool_malloc_sized_in(slack, 66, &capacity);
+  printf("\nTest Case 27a: %s", passed(capacity == 256 && pool_usable_size_in(slack, roomy) == 256, 1));
+
+  // Foreign pointers have no usable size
+  printf("\nTest Case 27b: %s", passed(pool_usable_size_in(slack, &capacity), 0));
+
+  // Only blocks of the instance are released when freeing a pointer of unknown origin
+  printf("\nTest Case 27c: %s", passed(!pool_try_free_in(slack, &capacity) && pool_try_free_in(slack, roomy)
+                                        && pool_malloc_in(slack, 66) == roomy, 1));
+  pool_destroy(slack);
+
+  // Test 28: Recording writes one event per allocation and free
+#ifdef POOL_TRACE
+  pool_t* traced = pool_create(&slack_config);
+  pool_trace_start("pool_trace_test.bin");
+  void* resized = pool_malloc_in(traced, 100);
+  pool_free_in(traced, pool_realloc_in(traced, resized, 200));
+  pool_trace_stop();
+  FILE* trace = fopen("pool_trace_test.bin", "rb");
+  pool_trace_header header = {0};
+  pool_trace_event events[5];
+  fread(&header, sizeof(header), 1, trace);
+  size_t event_count = fread(events, sizeof(pool_trace_event), 5, trace);
+  fclose(trace);
+  remove("pool_trace_test.bin");
+  printf("\nTest Case 28a: %s", passed(header.magic == POOL_TRACE_MAGIC && event_count == 4
+                                        && events[0].op == POOL_TRACE_MALLOC && events[0].size == 100
+                                        && events[3].op == POOL_TRACE_FREE && events[3].id == events[2].id, 1));
+
+  // Growing in place is recorded as a free and an allocation of the new size
+  printf("\nTest Case 28b: %s", passed(events[1].op == POOL_TRACE_FREE && events[1].id == events[0].id
+                                        && events[2].op == POOL_TRACE_MALLOC && events[2].size == 200, 1));
+  pool_destroy(traced);
+#else
+  printf("\nTest Case 28: %s", passed(pool_trace_start("pool_trace_test.bin"), 0));
+#endif
+
+  // Test 29: A size class resolved once serves allocations and frees
+  size_t class_block[3] = {24, 48, 64};
+  pool_config class_config = {.block_sizes = class_block, .block_size_count = 3};
+  pool_t* classed = pool_create(&class_config);
+  size_t size_class = pool_size_class_in(classed, 20, 16);
+  void* object = pool_malloc_class_in(classed, size_class);
+  printf("\nTest Case 29a: %s", passed(size_class == 1 && pool_usable_size_in(classed, object) == 48
+                                        && (uintptr_t)object % 16 == 0, 1));
+  pool_free_class_in(classed, size_class, object);
+  printf("\nTest Case 29b: %s", passed(pool_malloc_class_in(classed, size_class) == object, 1));
+
+  // Requests no pool can hold have no size class
+  printf("\nTest Case 29c: %s", passed(pool_size_class_in(classed, 65, 8) == POOL_NO_CLASS
+                                        && pool_size_class_in(classed, 8, 3) == POOL_NO_CLASS
+                                        && pool_malloc_class_in(classed, POOL_NO_CLASS) == NULL, 1));
+  pool_destroy(classed);
+
+#ifdef POOL_THREAD_SAFE
+  // Test 31: Blocks idle in another thread's cache can still be allocated
+  size_t mt_block[4] = {32, 64, 256, 1024};
+  pool_config mt_config = {.block_sizes = mt_block, .block_size_count = 4};
+  g_mt_pool = pool_create(&mt_config);
+  pthread_barrier_init(&g_mt_barrier, NULL, 2);
+  pthread_t helper;
+  pthread_create(&helper, NULL, mt_helper, NULL);
+  pthread_barrier_wait(&g_mt_barrier);
+
+  void* mt_held[17];
+  size_t mt_taken = 0;
+  while (mt_taken < 17 && (mt_held[mt_taken] = pool_malloc_in(g_mt_pool, 1000)) != NULL) {
+    mt_taken++;
+  }
+  printf("\nTest Case 31a: %s", passed(mt_taken == 16, 1));
+
+  // Every block freed here is allocated by the helper
+  while (mt_taken > 0) {
+    pool_free_in(g_mt_pool, mt_held[--mt_taken]);
+  }
+  pthread_barrier_wait(&g_mt_barrier);
+  pthread_barrier_wait(&g_mt_barrier);
+  printf("\nTest Case 31b: %s", passed(g_mt_count == 16, 1));
+
+  // Blocks the helper allocated are freed here and allocated again
+  for (size_t i = 0; i < g_mt_count; i++) {
+    pool_free_in(g_mt_pool, g_mt_blocks[i]);
+  }
+  while (mt_taken < 17 && (mt_held[mt_taken] = pool_malloc_in(g_mt_pool, 1000)) != NULL) {
+    mt_taken++;
+  }
+  printf("\nTest Case 31c: %s", passed(mt_taken == 16, 1));
+  pthread_join(helper, NULL);
+  pthread_barrier_destroy(&g_mt_barrier);
+  pool_destroy(g_mt_pool);
+
+  // Test 32: Threads allocating and freeing each other's blocks never
+  // receive a block twice, in fixed, growing and slab instances
+  size_t stress_block[4] = {32, 64, 256, 1024};
+  pool_config stress_config = {.block_sizes = stress_block, .block_size_count = 4};
+  pool_t* stressed = pool_create(&stress_config);
+  int stress_full = stress_capacity(stressed);
+  printf("\nTest Case 32a: %s", passed(stress_run(stressed, 50000, NULL), 1));
+  // exiting threads hand their cached blocks back, so none are lost
+  printf("\nTest Case 32b: %s", passed(stress_full == 16 && stress_capacity(stressed) == stress_full, 1));
+  pool_destroy(stressed);
+
+  stress_config.chunk_size = 4096;
+  stressed = pool_create(&stress_config);
+  printf("\nTest Case 32c: %s", passed(stress_run(stressed, 50000, NULL), 1));
+  pool_destroy(stressed);
+
+  stress_config.chunk_size = 0;
+  stress_config.slab_size = 4096;
+  stressed = pool_create(&stress_config);
+  printf("\nTest Case 32d: %s", passed(stress_run(stressed, 50000, NULL), 1));
+  pool_destroy(stressed);
+
+  // Test 33: Threads holding cached blocks survive their instance being
+  // laid out again, they only receive blocks of the new layout
+  size_t relayout_block[4] = {32, 64, 256, 1024};
+  pool_init(relayout_block, 4);
+  printf("\nTest Case 33a: %s", passed(stress_run(NULL, 50000, stress_relayout), 1));
+
+  // An instance can be destroyed while threads still hold caches of it
+  stress_config.slab_size = 0;
+  stressed = pool_create(&stress_config);
+  printf("\nTest Case 33b: %s", passed(stress_run(stressed, 50000, stress_destroy), 1));
+#endif
+
   return 0;
 }
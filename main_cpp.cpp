@@ -0,0 +1,214 @@
+#include <cstdio>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <new>
+#include <unordered_map>
+#include <vector>
+#include "pool_alloc.hpp"
+#include "pool_object.hpp"
+#if __cplusplus >= 201703L
+#include "pool_resource.hpp"
+#endif
+
+/*
+ * This file tests the C++ interfaces defined in pool_alloc.hpp,
+ * pool_object.hpp and pool_resource.hpp (C++17 builds) on top of the C
+ * allocator. Containers are filled through the adapters and their
+ * nodes checked to come from the pool instance they were given.
+ */
+
+#ifdef POOL_STATIC_CONFIG
+// built before main, with no init call made yet
+static pool_object<double> g_early_doubles;
+#endif
+
+const char* passed(int ret, int expected) {
+
+  if (ret == expected){
+    return "Test Passed\n";
+  }
+  else {
+    return "Test Failed\n";
+  }
+}
+
+int main()
+{
+  const size_t block_sizes[5] = {32, 64, 128, 256, 4096};
+  pool_config config = {};
+  config.block_sizes = block_sizes;
+  config.block_size_count = 5;
+  config.heap_size = 5 * 65536;
+  config.chunk_size = 65536;
+  pool_t* pool = pool_create(&config);
+
+  printf("-------------------------");
+  printf("\nAllocator Tests\n");
+
+  // Test case 1: blocks come from the instance, list nodes survive its growth
+  {
+    PoolAllocator<int> alloc(pool);
+    int* block = alloc.allocate(4);
+    printf("\nTest Case 1a: %s", passed(pool_usable_size_in(pool, block) >= 4 * sizeof(int), 1));
+    alloc.deallocate(block, 4);
+
+    // an empty request gets a distinct block rather than throwing
+    int* none = alloc.allocate(0);
+    int* other = alloc.allocate(0);
+    printf("\nTest Case 1b: %s", passed(none != nullptr && other != nullptr && none != other
+                                        && pool_usable_size_in(pool, none) != 0, 1));
+    alloc.deallocate(other, 0);
+    alloc.deallocate(none, 0);
+
+    std::list<int, PoolAllocator<int>> values{alloc};
+    for (int i = 0; i < 20000; ++i) {
+      values.push_back(i);
+    }
+    long long sum = 0;
+    for (const int& value : values) {
+      sum += value;
+    }
+    printf("\nTest Case 1c: %s", passed(sum == 20000LL * 19999 / 2, 1));
+  }
+
+  // Test case 2: rebound allocators of map and unordered_map share the instance,
+  // the bucket array of the unordered_map comes from the 4096-byte pool
+  {
+    using map_alloc = PoolAllocator<std::pair<const int, double>>;
+    std::map<int, double, std::less<int>, map_alloc> tree{map_alloc(pool)};
+    std::unordered_map<int, double, std::hash<int>, std::equal_to<int>, map_alloc> table{16, std::hash<int>(),
+                                                                                         std::equal_to<int>(), map_alloc(pool)};
+    for (int i = 0; i < 200; ++i) {
+      tree[i] = i * 0.5;
+      table[i] = i * 0.25;
+    }
+    PoolAllocator<char> rebound(tree.get_allocator());
+    printf("\nTest Case 2a: %s", passed(rebound == PoolAllocator<char>(pool), 1));
+    printf("\nTest Case 2b: %s", passed(tree.at(100) == 100 * 0.5 && table.at(199) == 199 * 0.25, 1));
+    printf("\nTest Case 2c: %s", passed(PoolAllocator<int>() != PoolAllocator<int>(pool), 1));
+  }
+
+  // Test case 3: requests no pool can hold throw bad_alloc
+  {
+    bool threw = false;
+    try {
+      std::vector<int, PoolAllocator<int>> values(2000, 0, PoolAllocator<int>(pool));
+    }
+    catch (const std::bad_alloc&) {
+      threw = true;
+    }
+    printf("\nTest Case 3: %s", passed(threw, 1));
+  }
+
+  // Test case 4: freed nodes are reused by the next container
+  {
+    const void* first;
+    {
+      std::list<int, PoolAllocator<int>> values{PoolAllocator<int>(pool)};
+      values.push_back(1);
+      first = &values.front();
+    }
+    std::list<int, PoolAllocator<int>> values{PoolAllocator<int>(pool)};
+    values.push_back(2);
+    printf("\nTest Case 4: %s", passed(&values.front() == first, 1));
+  }
+
+  printf("\n-------------------------");
+  printf("\nObject Pool Tests\n");
+
+  // Test case 5: objects are built in the size class bound to their type
+  {
+    struct point {
+      double x, y, z;
+      point(double a, double b, double c) : x(a), y(b), z(c) {}
+    };
+    pool_object<point> points(pool);
+    point* p = points.create(1.0, 2.0, 3.0);
+    printf("\nTest Case 5a: %s", passed(points.size_class() == 0 && pool_usable_size_in(pool, p) == 32
+                                        && p->y == 2.0, 1));
+    points.destroy(p);
+    printf("\nTest Case 5b: %s", passed(points.create(4.0, 5.0, 6.0) == p, 1));
+    points.destroy(p);
+  }
+
+  // Test case 6: a throwing constructor returns the block
+  {
+    struct fragile {
+      explicit fragile(bool fail) { if (fail) throw 1; }
+    };
+    pool_object<fragile> fragiles(pool);
+    fragile* first = fragiles.create(false);
+    fragiles.destroy(first);
+    bool threw = false;
+    try {
+      fragiles.create(true);
+    }
+    catch (int) {
+      threw = true;
+    }
+    fragile* second = fragiles.create(false);
+    printf("\nTest Case 6: %s", passed(threw && second == first, 1));
+    fragiles.destroy(second);
+  }
+
+#if __cplusplus >= 201703L
+  printf("\n-------------------------");
+  printf("\nMemory Resource Tests\n");
+
+  // Test case 7: pmr containers draw from the instance at the requested alignment
+  {
+    pool_memory_resource resource(pool);
+    std::pmr::list<int> values(&resource);
+    values.push_back(7);
+    void* aligned = resource.allocate(48, 16);
+    printf("\nTest Case 7a: %s", passed(pool_usable_size_in(pool, aligned) != 0
+                                        && ((uintptr_t)aligned & 15) == 0, 1));
+    resource.deallocate(aligned, 48, 16);
+    printf("\nTest Case 7b: %s", passed(values.front() == 7, 1));
+  }
+
+  // Test case 8: requests no pool can hold go upstream, or throw without one
+  {
+    pool_memory_resource fallback(pool, std::pmr::new_delete_resource());
+    std::pmr::vector<int> values(4000, 1, &fallback);
+    printf("\nTest Case 8a: %s", passed(pool_usable_size_in(pool, values.data()) == 0 && values[3999] == 1, 1));
+
+    pool_memory_resource bounded(pool);
+    bool threw = false;
+    try {
+      void* ptr = bounded.allocate(8192);
+      bounded.deallocate(ptr, 8192);
+    }
+    catch (const std::bad_alloc&) {
+      threw = true;
+    }
+    printf("\nTest Case 8b: %s", passed(threw, 1));
+    printf("\nTest Case 8c: %s", passed(bounded.is_equal(pool_memory_resource(pool)) && !bounded.is_equal(fallback), 1));
+  }
+#endif
+
+#ifdef POOL_STATIC_CONFIG
+  printf("\n-------------------------");
+  printf("\nStatic Configuration Tests\n");
+
+  // Test case 9: the compile-time layout resolves size classes in constant expressions
+  {
+    static_assert(pool_static_class(sizeof(double) * 3, alignof(double)) == 0, "24 bytes fit the first pool");
+    static_assert(pool_object<double>::static_class == 0, "a double is bound at compile time");
+    pool_object<double> doubles;
+    double* value = doubles.create(2.5);
+    printf("\nTest Case 9a: %s", passed(doubles.size_class() == pool_object<double>::static_class
+                                        && *value == 2.5, 1));
+    doubles.destroy(value);
+
+    // a pool_object constructed before main already has its size class
+    double* early = g_early_doubles.create(1.5);
+    printf("\nTest Case 9b: %s", passed(g_early_doubles.size_class() == 0 && *early == 1.5, 1));
+    g_early_doubles.destroy(early);
+  }
+#endif
+
+  pool_destroy(pool);
+  return 0;
+}
@@ -0,0 +1,332 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+/*
+ * This file tests the LD_PRELOAD shim built from preload.c. It must run
+ * with the shim preloaded, its first test fails otherwise. The C
+ * allocation functions are checked directly, including pointers handed
+ * out by the C library's own malloc, then this program runs itself again
+ * under the shim, which its environment passes on, in a heavy allocation
+ * mode selected by its argument.
+ */
+
+#define SHIM_LARGEST 32768 // largest size class of preload.c
+
+const char* passed(int ret, int expected) {
+
+  if (ret == expected){
+    return "Test Passed\n";
+  }
+  else {
+    return "Test Failed\n";
+  }
+}
+
+/*
+ * Helper thread of test 7, it allocates blocks for main to free.
+ */
+static void* block_maker(void* arg)
+{
+  void** blocks = arg;
+  for (int i = 0; i < 256; i++){
+    blocks[i] = malloc(24 + i % 200);
+    memset(blocks[i], 0x5A, 24);
+  }
+  return NULL;
+}
+
+static volatile int g_churn_stop; // set once test 8 has finished forking
+
+/*
+ * Helper thread of test 8, it keeps the allocator busy while main forks.
+ */
+static void* churner(void* arg)
+{
+  (void)arg;
+  void* held[64] = {NULL};
+  for (unsigned i = 0; !g_churn_stop; i++){
+    free(held[i % 64]);
+    // every eighth request is too large for a size class and is mapped
+    held[i % 64] = malloc(i % 8 == 0 ? SHIM_LARGEST + 1 : 16 + (i * 37) % 4000);
+  }
+  for (int i = 0; i < 64; i++){
+    free(held[i]);
+  }
+  return NULL;
+}
+
+/*
+ * Helper thread of the heavy mode, it grows, checks and frees strings.
+ */
+static void* heavy_thread(void* arg)
+{
+  unsigned seed = (unsigned)(uintptr_t)arg;
+  intptr_t bad = 0;
+  char* kept[512] = {NULL};
+  for (unsigned i = 0; i < 200000; i++){
+    unsigned slot = (i * 2654435761u + seed) % 512;
+    if (kept[slot] != NULL){
+      size_t length = strlen(kept[slot]);
+      bad |= length == 0 || kept[slot][length - 1] != (char)('a' + length % 26);
+      free(kept[slot]);
+    }
+    size_t length = 1 + (i * 37 + seed) % (i % 16 == 0 ? 2 * SHIM_LARGEST : 600);
+    kept[slot] = malloc(length + 1);
+    if (kept[slot] == NULL){
+      return (void*)1;
+    }
+    memset(kept[slot], 'a' + length % 26, length);
+    kept[slot][length] = '\0';
+  }
+  for (int i = 0; i < 512; i++){
+    free(kept[i]);
+  }
+  return (void*)bad;
+}
+
+static int compare_strings(const void* a, const void* b)
+{
+  return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+/*
+ * Heavy mode of test 9b, run by a child that inherits the shim: growing
+ * arrays, sorted strings, aligned and zeroed blocks and allocating threads.
+ * Returns: 0 if every allocation held its contents, 1 otherwise
+ */
+static int heavy_allocation(void)
+{
+  int bad = 0;
+  size_t count = 0;
+  size_t capacity = 0;
+  char** words = NULL;
+  for (unsigned i = 0; i < 20000; i++){
+    if (count == capacity){
+      capacity = capacity == 0 ? 4 : capacity * 2;
+      char** grown = realloc(words, capacity * sizeof(*words));
+      if (grown == NULL){
+        return 1;
+      }
+      words = grown;
+    }
+    char word[32];
+    snprintf(word, sizeof(word), "%u-%u", (i * 7919) % 20000, i % 64);
+    words[count] = strdup(word);
+    bad |= words[count] == NULL;
+    count += words[count] != NULL;
+  }
+  qsort(words, count, sizeof(*words), compare_strings);
+  for (size_t i = 1; i < count; i++){
+    bad |= strcmp(words[i - 1], words[i]) > 0;
+  }
+  for (size_t i = 0; i < count; i++){
+    free(words[i]);
+  }
+  free(words);
+
+  for (size_t size = 1; size <= 4 * SHIM_LARGEST; size = size * 3 + 1){
+    unsigned char* zeroed = calloc(size, 1);
+    void* aligned = NULL;
+    bad |= zeroed == NULL || posix_memalign(&aligned, 64, size) != 0 || (uintptr_t)aligned % 64 != 0;
+    for (size_t i = 0; zeroed != NULL && i < size; i++){
+      bad |= zeroed[i] != 0;
+    }
+    free(zeroed);
+    free(aligned);
+  }
+
+  pthread_t threads[4];
+  for (uintptr_t i = 0; i < 4; i++){
+    bad |= pthread_create(&threads[i], NULL, heavy_thread, (void*)(i + 1)) != 0;
+  }
+  for (int i = 0; i < 4; i++){
+    void* thread_bad = (void*)1;
+    pthread_join(threads[i], &thread_bad);
+    bad |= thread_bad != NULL;
+  }
+  return bad;
+}
+
+/*
+ * Runs this program again with mode as its argument, in a child that
+ * inherits the environment and so the preloaded shim.
+ * Returns: Exit status of the child, -1 if it did not exit normally
+ */
+static int run_self(const char* mode)
+{
+  pid_t child = fork();
+  if (child == 0){
+    execl("/proc/self/exe", "main_preload", mode, (char*)NULL);
+    _exit(127);
+  }
+  int child_status = 0;
+  if (child < 0 || waitpid(child, &child_status, 0) != child || !WIFEXITED(child_status)){
+    return -1;
+  }
+  return WEXITSTATUS(child_status);
+}
+
+int main(int argc, char** argv)
+{
+  if (argc > 1 && strcmp(argv[1], "--shim") == 0){
+    // the shim rounds 20 bytes up to its 32 byte class, the C library does not
+    void* probe = malloc(20);
+    int preloaded = malloc_usable_size(probe) == 32;
+    free(probe);
+    return preloaded ? 0 : 1;
+  }
+  if (argc > 1 && strcmp(argv[1], "--heavy") == 0){
+    return heavy_allocation();
+  }
+
+  printf("-------------------------");
+  printf("\nShim Tests\n");
+
+  // Test case 1: malloc is served by the shim's size classes
+  void* small = malloc(20);
+  printf("\nTest Case 1: %s", passed(small != NULL && malloc_usable_size(small) == 32, 1));
+  free(small);
+
+  // Test case 2: calloc clears recycled blocks, also after a thread cache flushes
+  uint8_t* dirty[100];
+  for (int i = 0; i < 100; i++){
+    dirty[i] = malloc(64);
+    memset(dirty[i], 0xAB, 64);
+  }
+  for (int i = 0; i < 100; i++){
+    free(dirty[i]);
+  }
+  int all_zero = 1;
+  for (int i = 0; i < 100; i++){
+    dirty[i] = calloc(8, 8);
+    for (int j = 0; dirty[i] != NULL && j < 64; j++){
+      all_zero &= dirty[i][j] == 0;
+    }
+    all_zero &= dirty[i] != NULL;
+  }
+  for (int i = 0; i < 100; i++){
+    free(dirty[i]);
+  }
+  printf("\nTest Case 2a: %s", passed(all_zero, 1));
+
+  // Large requests are mapped and read as zero too
+  uint8_t* large = calloc(1, SHIM_LARGEST + 1);
+  printf("\nTest Case 2b: %s", passed(large != NULL && large[SHIM_LARGEST] == 0
+                                       && malloc_usable_size(large) % 4096 == 0, 1));
+  free(large);
+
+  // Test case 3: realloc keeps the contents while growing across size classes
+  char* text = malloc(10);
+  strcpy(text, "resizable");
+  text = realloc(text, 100);
+  int kept = text != NULL && strcmp(text, "resizable") == 0;
+  text = realloc(text, 2 * SHIM_LARGEST);
+  kept &= text != NULL && strcmp(text, "resizable") == 0 && malloc_usable_size(text) >= 2 * SHIM_LARGEST;
+  text = realloc(text, 8);
+  printf("\nTest Case 3: %s", passed(kept && text != NULL && strcmp(text, "resizable") == 0, 1));
+  free(text);
+
+  // Test case 4: posix_memalign honours alignments of size classes and of mappings
+  void* aligned64 = NULL;
+  void* aligned8k = NULL;
+  int status = posix_memalign(&aligned64, 64, 100) | posix_memalign(&aligned8k, 8192, 100);
+  printf("\nTest Case 4a: %s", passed(status == 0 && (uintptr_t)aligned64 % 64 == 0
+                                       && (uintptr_t)aligned8k % 8192 == 0 && malloc_usable_size(aligned64) >= 100, 1));
+  free(aligned64);
+  free(aligned8k);
+
+  // Alignments that are not powers of two are rejected
+  void* misaligned = NULL;
+  printf("\nTest Case 4b: %s", passed(posix_memalign(&misaligned, 24, 100) != 0 && misaligned == NULL, 1));
+
+  // Test case 5: pointers from the C library's malloc are left alone, called
+  // through pointers the compiler cannot treat as the standard functions
+  void (*volatile shim_free)(void*) = free;
+  void* (*volatile shim_realloc)(void*, size_t) = realloc;
+  void* libc = dlopen("libc.so.6", RTLD_LAZY | RTLD_NOLOAD);
+  void* (*libc_malloc)(size_t) = libc != NULL ? (void* (*)(size_t))dlsym(libc, "malloc") : NULL;
+  void (*libc_free)(void*) = libc != NULL ? (void (*)(void*))dlsym(libc, "free") : NULL;
+  char* foreign = libc_malloc != NULL ? libc_malloc(48) : NULL;
+  if (foreign != NULL){
+    strcpy(foreign, "foreign");
+    shim_free(foreign);
+  }
+  printf("\nTest Case 5a: %s", passed(foreign != NULL && malloc_usable_size(foreign) == 0
+                                       && strcmp(foreign, "foreign") == 0, 1));
+
+  // realloc cannot move a block of unknown size and leaves it valid
+  printf("\nTest Case 5b: %s", passed(foreign != NULL && shim_realloc(foreign, 4096) == NULL
+                                       && strcmp(foreign, "foreign") == 0, 1));
+  if (foreign != NULL){
+    libc_free(foreign);
+  }
+
+  // pointers into the middle of a block are not taken for blocks
+  char* whole = malloc(40);
+  shim_free(whole + 16);
+  char* next = malloc(40);
+  printf("\nTest Case 5c: %s", passed(whole != NULL && next != whole + 16 && malloc_usable_size(whole + 16) == 0, 1));
+  free(next);
+  free(whole);
+
+  // Test case 6: zero-byte requests get distinct blocks
+  void* none = malloc(0);
+  void* other = malloc(0);
+  printf("\nTest Case 6: %s", passed(none != NULL && other != NULL && none != other, 1));
+  free(none);
+  free(other);
+
+  // Test case 7: blocks allocated by one thread are freed by another
+  void* blocks[256];
+  pthread_t maker;
+  int made = pthread_create(&maker, NULL, block_maker, blocks) == 0 && pthread_join(maker, NULL) == 0;
+  for (int i = 0; made && i < 256; i++){
+    made &= malloc_usable_size(blocks[i]) >= (size_t)(24 + i % 200);
+    free(blocks[i]);
+  }
+  printf("\nTest Case 7: %s", passed(made, 1));
+
+  // Test case 8: children forked while other threads allocate can allocate too
+  pthread_t churners[3];
+  int started = 0;
+  while (started < 3 && pthread_create(&churners[started], NULL, churner, NULL) == 0){
+    started++;
+  }
+  int healthy = 0;
+  for (int i = 0; i < 1000; i++){
+    pid_t child = fork();
+    if (child == 0){
+      alarm(5); // a lock inherited in its held state hangs the child
+      for (int j = 0; j < 64; j++){
+        free(malloc(j % 8 == 0 ? SHIM_LARGEST + 1 : 16 + j * 61));
+      }
+      _exit(0);
+    }
+    int child_status = 0;
+    healthy += child > 0 && waitpid(child, &child_status, 0) == child
+               && WIFEXITED(child_status) && WEXITSTATUS(child_status) == 0;
+  }
+  g_churn_stop = 1;
+  for (int i = 0; i < started; i++){
+    pthread_join(churners[i], NULL);
+  }
+  printf("\nTest Case 8: %s", passed(started == 3 && healthy == 1000, 1));
+
+  printf("\n-------------------------");
+  printf("\nProgram Tests\n");
+
+  // Test case 9: this program run again inherits the shim and allocates heavily under it
+  printf("\nTest Case 9a: %s", passed(run_self("--shim"), 0));
+  printf("\nTest Case 9b: %s", passed(run_self("--heavy"), 0));
+  return 0;
+}
@@ -0,0 +1,555 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pool_alloc.h"
+
+/*
+* Offline size-class optimizer. Reads an allocation trace recorded with
+* pool_trace_start, or a text histogram of "size count" lines giving how
+* many objects of each size are live at peak, and searches for the block
+* sizes and per-class block counts that need the smallest heap.
+*
+* Requests are bucketed into 8-byte granules as they are read, the smallest
+* block a pool can hold, so the search runs over distinct granules rather
+* than distinct request sizes. For every number of classes up to the pool
+* limit, dynamic programming places the class boundaries that waste the
+* fewest bytes across the objects live at peak, rejecting any class split
+* whose heap would already exceed the budget. Without a budget the best
+* split of a prefix only moves right as the prefix grows, so each number of
+* classes is solved by divide and conquer in O(n log n) rather than O(n^2)
+* over the n granules. The real heap each candidate
+* needs is then measured, by replaying the trace per class or by summing
+* the histogram, with every class rounded to whole pages as
+* pool_init_config does. The smallest heap that fits the budget wins, and
+* ties go to fewer classes. The result is printed as a pool_config ready to
+* paste into the application.
+*
+* Build with `gcc -O2 optimize.c -o optimize` and run
+* `./optimize input [-b budget] [-k classes] [-h headroom%]`.
+*/
+
+#define MAX_CLASSES 32      // matches the pool limit of pool_alloc.c
+#define PAGE_SIZE 256       // matches the page granularity of pool_alloc.c
+#define GRANULE 8           // smallest block, a free list link
+
+// demand for one rounded request size
+typedef struct {
+    uint64_t size;
+    uint64_t peak;          // objects of this size live at once, at most
+    uint64_t live;          // objects of this size live while replaying
+} size_demand;
+
+// one candidate set of classes
+typedef struct {
+    size_t count;
+    uint64_t sizes[MAX_CLASSES];
+    uint64_t blocks[MAX_CLASSES];
+    uint64_t heap;          // bytes of whole pages the classes need
+    uint64_t wasted;        // bytes lost to rounding up, over the objects live at peak
+} candidate;
+
+static pool_trace_event* g_events;  // trace being optimized, NULL for a histogram
+static size_t g_event_count;
+
+// open-addressed index of the demand entries by granule, at most half full
+static uint32_t* g_demand_slots;    // entry index + 1, 0 for an empty slot
+static size_t g_demand_slot_count;  // power of two
+
+static int compare_demand(const void* a, const void* b)
+{
+    uint64_t x = ((const size_demand*)a)->size;
+    uint64_t y = ((const size_demand*)b)->size;
+    return (x > y) - (x < y);
+}
+
+/*
+ * This function buckets a request into its block granule.
+ * Returns: Rounded size, never below GRANULE
+ */
+static uint64_t round_size(uint64_t size)
+{
+    size = (size + GRANULE - 1) & ~(uint64_t)(GRANULE - 1);
+    return size != 0 ? size : GRANULE;
+}
+
+/*
+ * This function finds the index slot of a rounded size, either the one
+ * holding its entry or the empty slot where the entry belongs.
+ * Returns: Pointer to the slot
+ */
+static uint32_t* demand_slot(const size_demand* demand, uint64_t size)
+{
+    size_t mask = g_demand_slot_count - 1;
+    size_t i = (size / GRANULE) * 0x9E3779B97F4A7C15u >> 32 & mask;
+    while (g_demand_slots[i] != 0 && demand[g_demand_slots[i] - 1].size != size) {
+        i = (i + 1) & mask;
+    }
+    return &g_demand_slots[i];
+}
+
+/*
+ * This function finds the entry of a rounded size, adding it if it is new.
+ * Returns: Pointer to the entry, NULL if out of memory
+ */
+static size_demand* find_demand(size_demand** demand, size_t* count, size_t* capacity, uint64_t size)
+{
+    // the index doubles before it gets more than half full
+    if ((*count + 1) * 2 > g_demand_slot_count) {
+        size_t grown_count = g_demand_slot_count != 0 ? g_demand_slot_count * 2 : 256;
+        uint32_t* grown = calloc(grown_count, sizeof(uint32_t));
+        if (grown == NULL) {
+            return NULL;
+        }
+        free(g_demand_slots);
+        g_demand_slots = grown;
+        g_demand_slot_count = grown_count;
+        for (size_t i = 0; i < *count; ++i) {
+            *demand_slot(*demand, (*demand)[i].size) = (uint32_t)(i + 1);
+        }
+    }
+
+    uint32_t* slot = demand_slot(*demand, size);
+    if (*slot != 0) {
+        return &(*demand)[*slot - 1];
+    }
+    if (*count == *capacity) {
+        size_t grown_capacity = *capacity != 0 ? *capacity * 2 : 64;
+        size_demand* grown = realloc(*demand, grown_capacity * sizeof(size_demand));
+        if (grown == NULL) {
+            return NULL;
+        }
+        *demand = grown;
+        *capacity = grown_capacity;
+    }
+    (*demand)[*count] = (size_demand){.size = size};
+    *slot = (uint32_t)(*count + 1);
+    return &(*demand)[(*count)++];
+}
+
+/*
+ * This function reads a trace or histogram into per-size demand, sorted by
+ * size. A trace is kept in g_events for measuring candidates exactly.
+ * Returns: Number of distinct sizes, 0 if the input is unreadable or empty
+ */
+static size_t load_demand(const char* path, size_demand** demand)
+{
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        return 0;
+    }
+
+    size_t count = 0;
+    size_t capacity = 0;
+    *demand = NULL;
+
+    pool_trace_header header;
+    if (fread(&header, sizeof(header), 1, file) == 1 && header.magic == POOL_TRACE_MAGIC
+        && header.version == POOL_TRACE_VERSION) {
+        size_t event_capacity = 4096;
+        g_events = malloc(event_capacity * sizeof(pool_trace_event));
+        while (g_events != NULL) {
+            g_event_count += fread(g_events + g_event_count, sizeof(pool_trace_event),
+                                   event_capacity - g_event_count, file);
+            if (g_event_count < event_capacity) {
+                break;
+            }
+            pool_trace_event* grown = realloc(g_events, event_capacity * 2 * sizeof(pool_trace_event));
+            if (grown == NULL) {
+                free(g_events);
+            }
+            g_events = grown;
+            event_capacity *= 2;
+        }
+        fclose(file);
+        if (g_events == NULL) {
+            return 0;
+        }
+
+        // the size of every live id is needed to account for its free
+        uint32_t max_id = 0;
+        for (size_t i = 0; i < g_event_count; ++i) {
+            max_id = g_events[i].id > max_id ? g_events[i].id : max_id;
+        }
+        uint64_t* id_size = calloc((size_t)max_id + 1, sizeof(uint64_t));
+        if (id_size == NULL) {
+            return 0;
+        }
+        for (size_t i = 0; i < g_event_count; ++i) {
+            const pool_trace_event* event = &g_events[i];
+            uint64_t size = event->op == POOL_TRACE_MALLOC ? round_size(event->size) : id_size[event->id];
+            if (size == 0) {
+                continue; // free of a block allocated before recording started
+            }
+            size_demand* entry = find_demand(demand, &count, &capacity, size);
+            if (entry == NULL) {
+                free(id_size);
+                return 0;
+            }
+            if (event->op == POOL_TRACE_MALLOC) {
+                id_size[event->id] = size;
+                if (++entry->live > entry->peak) {
+                    entry->peak = entry->live;
+                }
+            }
+            else {
+                id_size[event->id] = 0;
+                entry->live--;
+            }
+        }
+        free(id_size);
+    }
+    else {
+        // text histogram, one "size count" pair per line
+        rewind(file);
+        unsigned long long size;
+        unsigned long long objects;
+        while (fscanf(file, "%llu %llu", &size, &objects) == 2) {
+            size_demand* entry = find_demand(demand, &count, &capacity, round_size(size));
+            if (entry == NULL) {
+                fclose(file);
+                return 0;
+            }
+            entry->peak += objects;
+        }
+        fclose(file);
+    }
+
+    // sorting moves the entries, so the index is done with
+    free(g_demand_slots);
+    g_demand_slots = NULL;
+    g_demand_slot_count = 0;
+    qsort(*demand, count, sizeof(size_demand), compare_demand);
+    return count;
+}
+
+/*
+ * This function measures how many blocks each class needs, the peak of
+ * objects live at once in it. Trace input is replayed, histogram input
+ * assumes every size peaks together.
+ * Returns: True - if the blocks could be measured, else - False
+ */
+static bool measure_blocks(candidate* c, const size_demand* demand, size_t demand_count)
+{
+    memset(c->blocks, 0, sizeof(c->blocks));
+
+    if (g_events == NULL) {
+        size_t k = 0;
+        for (size_t i = 0; i < demand_count; ++i) {
+            while (demand[i].size > c->sizes[k]) {
+                k++;
+            }
+            c->blocks[k] += demand[i].peak;
+        }
+        return true;
+    }
+
+    uint32_t max_id = 0;
+    for (size_t i = 0; i < g_event_count; ++i) {
+        max_id = g_events[i].id > max_id ? g_events[i].id : max_id;
+    }
+    uint8_t* id_class = malloc((size_t)max_id + 1);
+    uint64_t live[MAX_CLASSES] = {0};
+    if (id_class == NULL) {
+        return false;
+    }
+    memset(id_class, 0xFF, (size_t)max_id + 1);
+
+    for (size_t i = 0; i < g_event_count; ++i) {
+        const pool_trace_event* event = &g_events[i];
+        if (event->op == POOL_TRACE_MALLOC) {
+            uint64_t size = round_size(event->size);
+            size_t lo = 0;
+            size_t hi = c->count - 1;
+            while (lo < hi) {
+                size_t mid = lo + (hi - lo) / 2;
+                if (c->sizes[mid] < size) {
+                    lo = mid + 1;
+                }
+                else {
+                    hi = mid;
+                }
+            }
+            id_class[event->id] = (uint8_t)lo;
+            if (++live[lo] > c->blocks[lo]) {
+                c->blocks[lo] = live[lo];
+            }
+        }
+        else if (id_class[event->id] != 0xFF) {
+            live[id_class[event->id]]--;
+            id_class[event->id] = 0xFF;
+        }
+    }
+    free(id_class);
+    return true;
+}
+
+/*
+ * This function adds headroom to the blocks a class needs.
+ * Returns: Blocks to give the class, at least one
+ */
+static uint64_t class_blocks(uint64_t blocks, uint64_t headroom)
+{
+    blocks += (blocks * headroom + 99) / 100;
+    return blocks != 0 ? blocks : 1; // every pool needs room for a block
+}
+
+/*
+ * This function gives the heap a class takes, rounded to whole pages.
+ * Returns: Bytes of the class
+ */
+static uint64_t class_heap(uint64_t size, uint64_t blocks)
+{
+    return (blocks * size + PAGE_SIZE - 1) & ~(uint64_t)(PAGE_SIZE - 1);
+}
+
+/*
+ * This function gives the bytes wasted by one class holding sizes j to i - 1,
+ * every object rounded up to the largest, from prefix sums of the objects
+ * and bytes live at peak.
+ * Returns: Bytes wasted
+ */
+static uint64_t class_waste(const size_demand* demand, const uint64_t* objects, const uint64_t* bytes,
+                            size_t j, size_t i)
+{
+    return demand[i - 1].size * (objects[i] - objects[j]) - (bytes[i] - bytes[j]);
+}
+
+/*
+ * This function fills entries lo to hi of one row of the class table when
+ * there is no budget, knowing their best splits lie between first and last.
+ * Moving an object into a class with a larger block wastes more, so the
+ * best split of a longer prefix is never left of a shorter one's: the
+ * middle entry is solved over the whole window and bounds both halves.
+ * Ties go to the rightmost split, as in the budgeted scan.
+ * Returns: No return value.
+ */
+static void place_row(const size_demand* demand, const uint64_t* objects, const uint64_t* bytes,
+                      const uint64_t* prev, uint64_t* row, uint32_t* row_split,
+                      size_t lo, size_t hi, size_t first, size_t last)
+{
+    while (lo <= hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        size_t best = first;
+        row[mid] = UINT64_MAX;
+        for (size_t j = first; j <= last && j < mid; ++j) {
+            if (prev[j] == UINT64_MAX) {
+                continue;
+            }
+            uint64_t waste = prev[j] + class_waste(demand, objects, bytes, j, mid);
+            if (waste <= row[mid]) {
+                row[mid] = waste;
+                best = j;
+            }
+        }
+        row_split[mid] = (uint32_t)best;
+
+        // the left half recurses, the right half continues the loop
+        if (mid > lo) {
+            place_row(demand, objects, bytes, prev, row, row_split, lo, mid - 1, first, best);
+        }
+        lo = mid + 1;
+        first = best;
+    }
+}
+
+/*
+ * This function places class boundaries over the sorted sizes so the bytes
+ * wasted by rounding objects up to their class are as few as possible,
+ * for every number of classes up to max_classes at once. With a budget,
+ * a split is rejected as soon as the heap of its classes exceeds it. That
+ * heap is exact for a histogram, for a trace it counts the busiest size of
+ * each class, the fewest blocks the class can have. Without a budget no
+ * split is rejected and place_row fills each row in O(n log n).
+ * Returns: True - if the table could be computed, else - False
+ */
+static bool place_classes(const size_demand* demand, size_t n, size_t max_classes, uint64_t budget,
+                          uint64_t headroom, candidate* out)
+{
+    // prefix sums of objects and bytes make the waste of any range O(1)
+    uint64_t* objects = calloc(n + 1, sizeof(uint64_t));
+    uint64_t* bytes = calloc(n + 1, sizeof(uint64_t));
+    uint64_t* cost = malloc((max_classes + 1) * (n + 1) * sizeof(uint64_t));
+    uint64_t* heap = malloc((max_classes + 1) * (n + 1) * sizeof(uint64_t));
+    uint32_t* split = malloc((max_classes + 1) * (n + 1) * sizeof(uint32_t));
+    if (objects == NULL || bytes == NULL || cost == NULL || heap == NULL || split == NULL) {
+        free(objects);
+        free(bytes);
+        free(cost);
+        free(heap);
+        free(split);
+        return false;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        objects[i + 1] = objects[i] + demand[i].peak;
+        bytes[i + 1] = bytes[i] + demand[i].peak * demand[i].size;
+    }
+
+    // cost[k][i] is the least waste covering the first i sizes with k classes
+    // within the budget, the largest size of each class being its block size,
+    // and heap[k][i] the heap those classes take
+    for (size_t i = 0; i <= n; ++i) {
+        cost[i] = i == 0 ? 0 : UINT64_MAX;
+        heap[i] = 0;
+    }
+    for (size_t k = 1; k <= max_classes; ++k) {
+        uint64_t* row = &cost[k * (n + 1)];
+        uint64_t* row_heap = &heap[k * (n + 1)];
+        const uint64_t* prev = &cost[(k - 1) * (n + 1)];
+        const uint64_t* prev_heap = &heap[(k - 1) * (n + 1)];
+        row[0] = UINT64_MAX;
+        if (budget == 0) {
+            for (size_t i = 1; i < k && i <= n; ++i) {
+                row[i] = UINT64_MAX;
+            }
+            place_row(demand, objects, bytes, prev, row, &split[k * (n + 1)], k, n, k - 1, n - 1);
+        }
+        else {
+            for (size_t i = 1; i <= n; ++i) {
+                row[i] = UINT64_MAX;
+                // the last class widens downwards, so its busiest size is kept as it goes
+                uint64_t busiest = 0;
+                for (size_t j = i; j-- > k - 1;) {
+                    busiest = demand[j].peak > busiest ? demand[j].peak : busiest;
+                    if (prev[j] == UINT64_MAX) {
+                        continue;
+                    }
+                    uint64_t blocks = g_events != NULL ? busiest : objects[i] - objects[j];
+                    uint64_t layout_heap = prev_heap[j] + class_heap(demand[i - 1].size, class_blocks(blocks, headroom));
+                    if (layout_heap > budget) {
+                        continue;
+                    }
+                    uint64_t waste = class_waste(demand, objects, bytes, j, i);
+                    if (prev[j] + waste < row[i]) {
+                        row[i] = prev[j] + waste;
+                        row_heap[i] = layout_heap;
+                        split[k * (n + 1) + i] = (uint32_t)j;
+                    }
+                }
+            }
+        }
+
+        candidate* c = &out[k - 1];
+        c->count = 0;
+        if (row[n] == UINT64_MAX) {
+            continue; // fewer sizes than classes, or none fit the budget
+        }
+        c->count = k;
+        c->wasted = row[n];
+        size_t i = n;
+        for (size_t level = k; level > 0; --level) {
+            c->sizes[level - 1] = demand[i - 1].size;
+            i = split[level * (n + 1) + i];
+        }
+    }
+
+    free(objects);
+    free(bytes);
+    free(cost);
+    free(heap);
+    free(split);
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    const char* path = NULL;
+    uint64_t budget = 0;
+    size_t max_classes = MAX_CLASSES;
+    uint64_t headroom = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            budget = strtoull(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc) {
+            max_classes = strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "-h") == 0 && i + 1 < argc) {
+            headroom = strtoull(argv[++i], NULL, 10);
+        }
+        else {
+            path = argv[i];
+        }
+    }
+    if (path == NULL || max_classes == 0 || max_classes > MAX_CLASSES) {
+        fprintf(stderr, "usage: %s input [-b budget] [-k classes] [-h headroom%%]\n", argv[0]);
+        return 1;
+    }
+
+    size_demand* demand = NULL;
+    size_t n = load_demand(path, &demand);
+    if (n == 0) {
+        fprintf(stderr, "Err: %s holds no allocations\n", path);
+        return 1;
+    }
+    if (max_classes > n) {
+        max_classes = n;
+    }
+
+    candidate candidates[MAX_CLASSES];
+    if (!place_classes(demand, n, max_classes, budget, headroom, candidates)) {
+        fprintf(stderr, "Err: Out of memory\n");
+        return 1;
+    }
+
+    candidate* best = NULL;
+    for (size_t k = 0; k < max_classes; ++k) {
+        candidate* c = &candidates[k];
+        if (c->count == 0) {
+            continue;
+        }
+        // a layout scored without its block counts would look like the smallest
+        if (!measure_blocks(c, demand, n)) {
+            fprintf(stderr, "Err: Out of memory\n");
+            free(demand);
+            free(g_events);
+            return 1;
+        }
+        c->heap = 0;
+        for (size_t i = 0; i < c->count; ++i) {
+            c->blocks[i] = class_blocks(c->blocks[i], headroom);
+            c->heap += class_heap(c->sizes[i], c->blocks[i]);
+        }
+        // a trace can need more blocks than its busiest sizes alone
+        if (budget != 0 && c->heap > budget) {
+            continue;
+        }
+        if (best == NULL || c->heap < best->heap) {
+            best = c;
+        }
+    }
+    if (best == NULL) {
+        fprintf(stderr, "Err: No layout of at most %zu classes fits the budget of %llu\n",
+                max_classes, (unsigned long long)budget);
+        free(demand);
+        free(g_events);
+        return 2;
+    }
+
+    uint64_t peak_bytes = 0;
+    for (size_t i = 0; i < n; ++i) {
+        peak_bytes += demand[i].peak * demand[i].size;
+    }
+    fprintf(stderr, "%zu sizes, %llu bytes live at peak per size, best: %zu classes, %llu byte heap, %llu bytes wasted\n",
+            n, (unsigned long long)peak_bytes, best->count, (unsigned long long)best->heap,
+            (unsigned long long)best->wasted);
+
+    printf("// generated by optimize from %s\n", path);
+    printf("static const size_t block_sizes[%zu] = {", best->count);
+    for (size_t i = 0; i < best->count; ++i) {
+        printf("%s%llu", i != 0 ? ", " : "", (unsigned long long)best->sizes[i]);
+    }
+    printf("};\nstatic const size_t block_counts[%zu] = {", best->count);
+    for (size_t i = 0; i < best->count; ++i) {
+        printf("%s%llu", i != 0 ? ", " : "", (unsigned long long)best->blocks[i]);
+    }
+    printf("};\nstatic const pool_config config = {.block_sizes = block_sizes, .block_size_count = %zu,\n"
+           "                                   .block_counts = block_counts, .heap_size = %llu};\n",
+           best->count, (unsigned long long)best->heap);
+
+    free(demand);
+    free(g_events);
+    return 0;
+}
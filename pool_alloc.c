@@ -1,181 +1,2485 @@
+#define _DEFAULT_SOURCE // MAP_ANONYMOUS and MAP_NORESERVE are not part of ISO C
 #include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#ifdef POOL_THREAD_SAFE
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#endif
+#ifdef POOL_TRACE
+#include <time.h>
+#endif
 #include "pool_alloc.h"
 
-/* 
+/*
 * Program functionality:
 * This file describes the implementation of a block pool memory allocator,
-* designed for quicker memory allocation given predefined block sizes. 
+* designed for quicker memory allocation given predefined block sizes.
 * The defined constants can be changed, the POOLS constant in particular
 * is used to simplify the creation of a list of structs and imposes a limit
-* on the number of block sizes allowed. Users are expected to handle error
-* cases. Detailed function-specific comments are provided below.
+* on the number of block sizes allowed. Pools are kept sorted by block size
+* and a lookup table indexed by rounded request size maps each request to
+* its best-fit pool, so the number of pools does not slow down allocation.
+* Users are expected to handle error cases. Detailed function-specific
+* comments are provided below.
+*
+* All state lives in a pool_t instance. pool_create hands out independent
+* instances, each with its own heap and pools, while pool_init, pool_malloc
+* and pool_free operate on a built-in default instance. A heap is either a
+* caller-owned buffer or an anonymous mapping of the requested size, the
+* default instance falls back to a static HEAP_SIZE array. An instance
+* configured with a chunk size grows instead of failing: a pool whose
+* partition is exhausted maps a fresh chunk from a reserved address range
+* and continues bumping through it. An instance configured with a slab size
+* has no fixed partitions, its heap is cut into slabs handed to whichever
+* pool runs dry. Freed blocks go back to the run of blocks they were carved
+* from, which counts how many of its blocks are in use, so in both modes a
+* chunk goes back to a shared reserve that any pool can draw from as soon
+* as its last block is freed.
 
-* This program is NOT thread-safe as the memory footprint must be fixed. 
-* Implementing thread-safe functionality could be done using libraries
-* such as POSIX thread.
+* By default this program is NOT thread-safe as the memory footprint must
+* be fixed. Compiling with -DPOOL_THREAD_SAFE (and -pthread) gives every
+* thread a small cache of free blocks per pool. pool_malloc and pool_free
+* work on that cache and only touch the shared pool to move a batch of
+* blocks in or out. Small fixed pools move smaller batches, and a fixed
+* pool that runs dry takes back the blocks other threads hold cached, so
+* an allocation only fails when the single-threaded build would. The
+* shared free lists are lock-free Treiber stacks with
+* a version tag packed into the head, and never-used blocks are claimed
+* with a fetch-and-add on the bump counter, so allocation and free take no
+* lock. Only growth serializes, pool_grow holds the instance's grow_lock
+* while it hands a chunk to a pool, and a thread taking back blocks from
+* other caches briefly holds each of them.
+* pool_init must not run concurrently with any other call on the default
+* instance, and pool_destroy must not run concurrently with any other call
+* on the instance being destroyed. pool_lock_all and pool_unlock_all hold
+* every lock of an instance across fork for pthread_atfork handlers.
+*
+* Compiling with -DPOOL_TRACE adds pool_trace_start, which records every
+* allocation and free of every instance to a binary trace of
+* pool_trace_event records for offline replay. Without it the calls are
+* compiled out and pool_trace_start fails.
+*
+* Compiling with -DPOOL_STATIC_CONFIG='"header.h"' lays out the default
+* instance at compile time from the POOL_STATIC_POOLS list in that header:
+* its partitions and pools are static initializers, no init call is needed
+* and pool_init fails. Its size classes come from pool_static_class, and
+* the owner of a heap page from a similar chain over the partition starts,
+* both branchless comparison chains the compiler can fold.
 *
 * Author: Sachin Sulkunte
 */
 
-#define HEAP_SIZE 65536 // given heap size
-#define POOLS 5     // imposed upper limit on number of block sizes (adjustable)
+#define HEAP_SIZE 65536 // heap size used when the configuration gives none
+#define POOLS 32    // imposed upper limit on number of block sizes (adjustable, at most 255)
+
+#define SIZE_GRANULE_SHIFT 3 // resolution of the size-class lookup table (8 bytes)
+#define SIZE_GRANULE (1 << SIZE_GRANULE_SHIFT)
+#define SIZE_TABLE_MAX 8192  // largest request size resolved through the lookup table
+
+#define POOL_PAGE_SHIFT 8    // granularity of the address-to-pool map (256 bytes)
+#define POOL_PAGE_SIZE (1 << POOL_PAGE_SHIFT)
+#define NO_POOL 0xFF         // page map entry for pages not owned by any pool
+
+#define CACHE_LINE 64        // instances are aligned so none share a cache line
+
+#define MIN_CHUNK_SHIFT 12   // growth chunks are at least one 4 KiB OS page
+#define GROW_LIMIT ((size_t)1 << 30) // address space reserved for growth by default
 
-static uint8_t g_pool_heap[HEAP_SIZE]; // for easy modification of heap size if needed
+#define TCACHE_BATCH 32      // blocks moved between a thread cache and a pool at once
+#define TCACHE_SHARE 8       // a fixed pool refills a cache with at most 1/TCACHE_SHARE of its blocks
+// refill batch of a pool holding capacity blocks, 0 for pools that grow,
+// a cache flushes back to one batch once it holds more than two
+#define CACHE_BATCH(capacity) ((capacity) == 0 || (capacity) / TCACHE_SHARE >= TCACHE_BATCH ? TCACHE_BATCH \
+                               : (capacity) / TCACHE_SHARE > 0 ? (uint32_t)((capacity) / TCACHE_SHARE) : 1)
+#define RUN_RETIRED (SIZE_MAX / 2) // live count of a released run, which no refill can pin
+
+// a block size is its lowest set bit times an odd factor. An offset is a
+// multiple of it when the bits below that bit are clear and the offset
+// times the inverse of the odd factor modulo 2^N is at most SIZE_MAX over
+// it, so freed pointers are checked without a division. Newton's method
+// doubles the correct low bits of the inverse with every step.
+#define BLOCK_LOW(size) ((size_t)(size) & (0 - (size_t)(size)))
+#define BLOCK_ODD(size) ((size_t)(size) / BLOCK_LOW(size))
+#define INVERSE_STEP(x, d) ((x) * (2 - (d) * (x)))
+#define BLOCK_INVERSE(size) INVERSE_STEP(INVERSE_STEP(INVERSE_STEP(INVERSE_STEP(INVERSE_STEP( \
+    BLOCK_ODD(size), BLOCK_ODD(size)), BLOCK_ODD(size)), BLOCK_ODD(size)), BLOCK_ODD(size)), BLOCK_ODD(size))
+
+// user-space pointers on x86-64 and AArch64 fit in 48 bits, the top 16 bits
+// of a shared free list head hold a version tag that defeats ABA
+#define TAG_SHIFT 48
+#define TAG_PTR(v) ((list_node*)(uintptr_t)((v) & ((UINT64_C(1) << TAG_SHIFT) - 1)))
+#define TAG_NEXT(v, p) (((((v) >> TAG_SHIFT) + 1) << TAG_SHIFT) | (uintptr_t)(p))
 
 // linked list node for keeping track of free blocks
 typedef struct {
     void* next;
 } list_node;
 
+#ifdef POOL_THREAD_SAFE
+// a stale stack_pop may read the link of a block another thread has already
+// popped and relinks, so every link that can be on a shared list is atomic
+#define NEXT_LOAD(node) ((list_node*)__atomic_load_n(&(node)->next, __ATOMIC_RELAXED))
+#define NEXT_STORE(node, value) __atomic_store_n(&(node)->next, (void*)(value), __ATOMIC_RELAXED)
+
+// ThreadSanitizer builds leave the speculative read in stack_peek untracked
+#if defined(__SANITIZE_THREAD__)
+#define NO_TSAN __attribute__((no_sanitize_thread, noinline))
+#elif defined(__has_feature)
+#if __has_feature(thread_sanitizer)
+#define NO_TSAN __attribute__((no_sanitize("thread"), noinline))
+#endif
+#endif
+#ifndef NO_TSAN
+#define NO_TSAN
+#endif
+#else
+#define NEXT_LOAD(node) ((list_node*)(node)->next)
+#define NEXT_STORE(node, value) ((node)->next = (value))
+#endif
+
+// contiguous blocks of a pool, its heap partition first and every growth
+// chunk it receives after that. Never-used blocks are handed out in address
+// order and freed blocks go back to the run they were carved from.
+typedef struct bump_run {
+    void* owner;             // pool_obj the run belongs to
+    uint8_t* start;          // address of the first block
+    bool zeroed;             // blocks not yet handed out read as zero
+    bool listed;             // on the owner's list of runs with free blocks
+    struct bump_run* next_partial; // neighbours on that list
+    struct bump_run* prev_partial;
+    size_t max;              // max blocks in the run
+#ifdef POOL_THREAD_SAFE
+    _Atomic size_t allocated; // num of contiguous blocks allocated, may overshoot max
+    _Atomic uint64_t head;   // tagged pointer to free blocks, see TAG_PTR
+    _Atomic size_t live;     // blocks handed out and not yet returned, see run_pin
+#else
+    size_t allocated;        // num of contiguous blocks allocated
+    list_node* head;         // pointer to free blocks
+    size_t live;             // blocks handed out and not yet returned
+#endif
+} bump_run;
+
 typedef struct {
-    uint16_t allocated;      // num of contiguous blocks allocated
+    bump_run partition;      // blocks of the pool's heap partition
+#ifdef POOL_THREAD_SAFE
+    bump_run* _Atomic bump;  // run currently bumped, replaced as a whole on growth
+#else
+    bump_run* bump;          // run currently bumped, partition until the pool grows
+#endif
+    bump_run* partial;       // runs other than the bumped one that have free blocks
     uint8_t* pool_start;     // start address of pool
     uint8_t* pool_end;       // end address of pool
-    uint16_t max;            // max blocks in partition
-    list_node* head;         // pointer to free blocks
     size_t block_size;       // tunable block size given by user
+    size_t block_low_mask;   // bits below the lowest set bit of block_size, see BLOCK_LOW
+    size_t block_inverse;    // inverse of the odd factor of block_size, see BLOCK_INVERSE
+    size_t block_limit;      // largest product of a multiple of that odd factor and block_inverse
+#ifdef POOL_THREAD_SAFE
+    uint32_t cache_batch;    // blocks a thread cache refills at once, smaller for small fixed pools
+#endif
 } pool_obj;
 
-static pool_obj pool_list[POOLS]; // defined pools for each block size
+// one growth chunk or slab, blocks larger than a chunk get a run spanning several
+typedef struct chunk_entry {
+    pool_obj* owner;         // pool the chunk was handed to, NULL while unused
+    bump_run* run;           // run the chunk belongs to
+    bump_run own_run;        // storage for a run starting at this chunk
+    size_t span;             // chunks covered by own_run
+    bool used;               // chunk was handed to a pool before and may be dirty
+    struct chunk_entry* next_free; // next chunk in the reserve
+} chunk_entry;
+
+#ifdef POOL_THREAD_SAFE
+// per-thread free blocks of one instance, used before its shared pools
+typedef struct thread_cache {
+    list_node* head[POOLS];  // cached free blocks for each pool
+    uint32_t count[POOLS];   // length of each cached list
+    uint32_t fresh[POOLS];   // never-used zeroed blocks at the end of each list
+    uint32_t generation;     // layout of the owner the cached blocks belong to
+    _Atomic bool busy;       // held by the owning thread, or by another one emptying the cache
+    pool_t* owner;           // instance the cache belongs to
+    struct thread_cache* next; // next cache of the same instance
+} thread_cache;
+#endif
+
+struct pool_t {
+    uint8_t* heap;                   // memory carved into the pools, page aligned
+    size_t heap_size;                // size of heap in bytes, whole pages
+    bool heap_mapped;                // heap was mapped by pool_setup and is unmapped with it
+    bool heap_zeroed;                // heap was never written, so its first blocks read as zero
+    pool_obj pool_list[POOLS];       // defined pools for each block size, ascending
+    size_t pool_count;               // number of pools set up for this instance
+
+    // first pool whose block size can hold the smallest request of each granule
+    uint8_t size_class_table[(SIZE_TABLE_MAX >> SIZE_GRANULE_SHIFT) + 1];
+
+    // owning pool of each heap page, pools start on page boundaries so none share a page
+    uint8_t* page_map;
+
+    uint8_t* grow_base;              // address range chunks are handed out from
+    size_t grow_chunks;              // chunks that fit in the range, 0 if growth is off
+    size_t grow_next;                // index of the next never-used chunk
+    unsigned chunk_shift;            // log2 of the chunk size
+    bool grow_reserved;              // range is reserved address space, not the heap
+    chunk_entry* chunk_table;        // descriptor of every chunk in the range
+    chunk_entry* reserve;            // released chunks ready for any pool
+#ifdef POOL_THREAD_SAFE
+    pthread_mutex_t grow_lock;       // serializes growth and the lists of runs, never taken on the fast path
+#endif
+
+#ifdef POOL_THREAD_SAFE
+    uint32_t generation;             // bumped on re-layout to invalidate caches
+    _Atomic bool cache_ready;        // cache_key has been created
+    pthread_key_t cache_key;         // calling thread's cache for this instance
+    pthread_mutex_t cache_lock;      // guards caches, only taken by new and exiting threads
+    thread_cache* caches;            // every live cache of this instance
+#endif
+};
+
+#ifdef POOL_STATIC_CONFIG
+#define STATIC_PAGES(size, count) (((size) * (count) + POOL_PAGE_SIZE - 1) >> POOL_PAGE_SHIFT)
+#define STATIC_FIRST_PAGE(size) (offsetof(static_heap, part_##size) >> POOL_PAGE_SHIFT)
+
+// one page-aligned partition per configured pool, named after its block size
+typedef struct {
+#define STATIC_PARTITION(size, count) _Alignas(POOL_PAGE_SIZE) uint8_t part_##size[STATIC_PAGES(size, count) << POOL_PAGE_SHIFT];
+    POOL_STATIC_POOLS(STATIC_PARTITION)
+#undef STATIC_PARTITION
+} static_heap;
+
+// index of each configured pool in pool_list
+enum {
+#define STATIC_INDEX(size, count) STATIC_POOL_##size,
+    POOL_STATIC_POOLS(STATIC_INDEX)
+#undef STATIC_INDEX
+};
+
+// each STATIC_ABOVE_ follows the previous block size, so it is one more than it
+enum {
+    STATIC_SIZE_NONE = 0,
+#define STATIC_ORDER(size, count) STATIC_ABOVE_##size, STATIC_SIZE_##size = (size),
+    POOL_STATIC_POOLS(STATIC_ORDER)
+#undef STATIC_ORDER
+};
+
+// pool_static_class counts the pools before the first that fits, so they must ascend
+_Static_assert(POOL_STATIC_COUNT > 0 && POOL_STATIC_COUNT <= POOLS, "POOL_STATIC_POOLS needs 1 to POOLS pools");
+#define STATIC_CHECK(size, count) _Static_assert((size) > 0 && (count) > 0, "pool " #size " needs blocks"); \
+    _Static_assert((size) >= STATIC_ABOVE_##size, "pool " #size " is not above the pool before it");
+POOL_STATIC_POOLS(STATIC_CHECK)
+#undef STATIC_CHECK
+
+static static_heap g_static_heap;
+
+#ifdef POOL_THREAD_SAFE
+#define STATIC_CACHE_BATCH(count) .cache_batch = CACHE_BATCH(count),
+#else
+#define STATIC_CACHE_BATCH(count)
+#endif
+
+// instance used by pool_malloc and pool_free, laid out by the compiler
+static pool_t g_default_pool = {
+    .heap = (uint8_t*)&g_static_heap,
+    .heap_size = sizeof(static_heap),
+    .heap_zeroed = true,
+    .pool_list = {
+#define STATIC_POOL(size, count) { \
+        .partition = {.owner = &g_default_pool.pool_list[STATIC_POOL_##size], \
+                      .start = g_static_heap.part_##size, .zeroed = true, .max = (count)}, \
+        .bump = &g_default_pool.pool_list[STATIC_POOL_##size].partition, \
+        .pool_start = g_static_heap.part_##size, \
+        .pool_end = g_static_heap.part_##size + (size) * (count), \
+        .block_size = (size), \
+        .block_low_mask = BLOCK_LOW(size) - 1, \
+        .block_inverse = BLOCK_INVERSE(size), \
+        .block_limit = SIZE_MAX / BLOCK_ODD(size), \
+        STATIC_CACHE_BATCH(count) \
+    },
+        POOL_STATIC_POOLS(STATIC_POOL)
+#undef STATIC_POOL
+    },
+    .pool_count = POOL_STATIC_COUNT,
+    .page_map = NULL, // see page_partition
+#ifdef POOL_THREAD_SAFE
+    .cache_lock = PTHREAD_MUTEX_INITIALIZER,
+    .grow_lock = PTHREAD_MUTEX_INITIALIZER,
+#endif
+};
+#else
+static _Alignas(POOL_PAGE_SIZE) uint8_t g_pool_heap[HEAP_SIZE]; // default instance heap
+static bool g_pool_heap_used;        // g_pool_heap was laid out before and may be dirty
+static uint8_t g_page_map[HEAP_SIZE >> POOL_PAGE_SHIFT];
+
+// instance used by pool_init, pool_malloc and pool_free
+static pool_t g_default_pool = {
+    .heap = g_pool_heap,
+    .heap_size = HEAP_SIZE,
+    .page_map = g_page_map,
+#ifdef POOL_THREAD_SAFE
+    .cache_lock = PTHREAD_MUTEX_INITIALIZER,
+    .grow_lock = PTHREAD_MUTEX_INITIALIZER,
+#endif
+};
+#endif
+
+#ifdef POOL_STATIC_CONFIG
+#define STATIC_PAGE_OWNER(size, count) + (page + 1 > STATIC_FIRST_PAGE(size))
+#endif
 
 /*
- * This function takes in a pointer to an array of block sizes as well
- * as the count of how many block sizes there are. The number of partitions
- * are defined and each pool is intitalized with its parameters.
- * Returns: True - if initialization is successful, else - False
+ * This function finds the pool a page of an instance's heap belongs to.
+ * The default instance of a POOL_STATIC_CONFIG build has no page map, its
+ * partitions follow each other in pool order, so the owner is the number
+ * of partitions starting at or before the page, less one.
+ * Returns: Index of the owning pool, NO_POOL if the page is in none
  */
-bool pool_init(const size_t* block_sizes, size_t block_size_count)
+static inline uint8_t page_partition(const pool_t* pool, size_t page)
 {
-    // upper limit surpassed or negative number of blocks (assumed max of 256 blocks)
-    if (block_size_count > POOLS || (int8_t) block_size_count <= 0) {
-        //fprintf(stderr, "Err: Invalid parameters\n");
-        return false;
+#ifdef POOL_STATIC_CONFIG
+    if (pool->page_map == NULL) {
+        return (uint8_t)(0 POOL_STATIC_POOLS(STATIC_PAGE_OWNER) - 1);
     }
+#endif
+    return pool->page_map[page];
+}
 
-    size_t unused = HEAP_SIZE;
-    // Assumption - user wants equal-sized partitions for all block sizes
-    uint16_t partition = unused / block_size_count;
+#ifdef POOL_THREAD_SAFE
+/*
+ * This function pushes a linked segment of blocks onto a run's shared
+ * free list with a single compare-and-swap.
+ * Returns: True if the list was empty before the push
+ */
+static bool stack_push(bump_run* run, list_node* first, list_node* last)
+{
+    uint64_t old = atomic_load_explicit(&run->head, memory_order_relaxed);
+    do {
+        NEXT_STORE(last, TAG_PTR(old));
+    } while (!atomic_compare_exchange_weak_explicit(&run->head, &old, TAG_NEXT(old, first),
+             memory_order_release, memory_order_relaxed));
+    return TAG_PTR(old) == NULL;
+}
 
-    uint8_t* heap_start = g_pool_heap;
-    uint8_t* heap_end = g_pool_heap + sizeof(g_pool_heap);
-    uint8_t* current_addr = heap_start;
+/*
+ * This function reads the link of the block on top of a shared free list.
+ * Another thread may have popped the block already and handed it to a
+ * caller that writes it. The value read is then discarded, the tag makes
+ * the compare-and-swap fail, so this one read is not tracked as a race.
+ * Returns: Link of the block
+ */
+NO_TSAN static list_node* stack_peek(list_node* node)
+{
+    return NEXT_LOAD(node);
+}
 
-    // determine if any block_sizes are invalid
-    for (int i = 0; i < block_size_count; ++i) {
-        if (block_sizes[i] > partition || current_addr > heap_end
-        || (int16_t) block_sizes[i] <= 0) { 
-          return false;
+/*
+ * This function pops one block from a run's shared free list. The next
+ * pointer read may be stale if another thread won the race, the tag makes
+ * the compare-and-swap fail in that case.
+ * Returns: Pointer to the popped block, NULL if the list is empty
+ */
+static list_node* stack_pop(bump_run* run)
+{
+    uint64_t old = atomic_load_explicit(&run->head, memory_order_acquire);
+    list_node* node;
+    do {
+        node = TAG_PTR(old);
+        if (node == NULL) {
+            return NULL;
         }
-        
-        // define pool for specific block size
-        pool_list[i].pool_start = current_addr;
-        pool_list[i].head = NULL;
-        pool_list[i].block_size = block_sizes[i];
-        pool_list[i].max = partition / block_sizes[i]; // any excess partial block is ignored
-        pool_list[i].pool_end = current_addr + (pool_list[i].max * pool_list[i].block_size);
-        unused -= partition;
-        current_addr += (pool_list[i].max * pool_list[i].block_size);
+    } while (!atomic_compare_exchange_weak_explicit(&run->head, &old, TAG_NEXT(old, stack_peek(node)),
+             memory_order_acquire, memory_order_acquire));
+    return node;
+}
+
+/*
+ * This function claims up to want never-used blocks from a pinned run with
+ * one fetch-add on its bump counter. A claim racing past the end leaves
+ * the counter above max, which the 64-bit counter absorbs.
+ * Returns: Number of blocks claimed, the first one is written to first
+ */
+static uint32_t bump_claim(bump_run* run, uint32_t want, size_t* first)
+{
+    // a full run is left alone so repeated refills do not keep bumping
+    if (atomic_load_explicit(&run->allocated, memory_order_relaxed) >= run->max) {
+        return 0;
     }
-    // successful initialization of pools
+
+    size_t old = atomic_fetch_add_explicit(&run->allocated, want, memory_order_relaxed);
+    if (old >= run->max) {
+        return 0;
+    }
+    *first = old;
+    return run->max - old < want ? (uint32_t)(run->max - old) : want;
+}
+
+/*
+ * This function keeps a run from being released while the calling thread
+ * takes blocks from it. A refill may still hold a run loaded as its pool's
+ * current one after the run was released, so pinning a released run fails,
+ * and a run released and handed out again is caught by the caller checking
+ * its owner once pinned.
+ * Returns: True - if the run was pinned, else - False
+ */
+static bool run_pin(bump_run* run)
+{
+    size_t live = atomic_load_explicit(&run->live, memory_order_relaxed);
+    do {
+        if (live >= RUN_RETIRED) {
+            return false;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&run->live, &live, live + 1,
+             memory_order_acquire, memory_order_relaxed));
     return true;
 }
+#endif
 
 /*
- * This function is passed an unsigned value corresponding to the desired
- * memory size to be allocated. Algorithm follows a best-fit approach, the
- * smallest block size that can meet the needs of the user is allocated
- * to the request. If all blocks are full, the memory is allocated from the
- * next largest pool.
- *
- * O(n) operation where n = POOLS
- *
- * Returns: Pointer to allocated memory if successful, NULL if failed
- */ 
-void* pool_malloc(size_t n)
+ * This function takes chunks for a new run from the reserve when it holds
+ * enough: any released chunk when one is enough, else the first stretch of
+ * adjacent released chunks, which are unlinked from it. Otherwise it takes
+ * never-used chunks from the end of the range. Chunks of a reserved range
+ * are made accessible only now, so untouched capacity costs no memory.
+ * Returns: Entry of the first chunk, NULL if none are left
+ */
+static chunk_entry* chunk_take(pool_t* pool, size_t chunks)
 {
+    if (chunks == 1 && pool->reserve != NULL) {
+        chunk_entry* entry = pool->reserve;
+        pool->reserve = entry->next_free;
+        return entry;
+    }
 
-    if ((int64_t)n <= 0) {
-      //fprintf(stderr, "Err: Cannot allocate non-positive value\n");
-      return NULL; // failure case - cannot allocate negative value
+    // runs of several chunks need them adjacent, released ones are owned by no pool
+    size_t adjacent = 0;
+    for (size_t i = 0; pool->reserve != NULL && i < pool->grow_next; ++i) {
+        adjacent = pool->chunk_table[i].owner == NULL ? adjacent + 1 : 0;
+        if (adjacent == chunks) {
+            chunk_entry* entry = &pool->chunk_table[i + 1 - chunks];
+            chunk_entry** link = &pool->reserve;
+            while (*link != NULL) {
+                if (*link >= entry && *link < entry + chunks) {
+                    *link = (*link)->next_free;
+                }
+                else {
+                    link = &(*link)->next_free;
+                }
+            }
+            return entry;
+        }
+    }
+
+    if (chunks > pool->grow_chunks - pool->grow_next) {
+        return NULL;
+    }
+
+    uint8_t* chunk = pool->grow_base + (pool->grow_next << pool->chunk_shift);
+    if (pool->grow_reserved
+        && mprotect(chunk, chunks << pool->chunk_shift, PROT_READ | PROT_WRITE) != 0) {
+        return NULL;
     }
 
-    pool_obj* curr_pool = NULL;
+    chunk_entry* entry = &pool->chunk_table[pool->grow_next];
+    pool->grow_next += chunks;
+    return entry;
+}
+
+/*
+ * This function adds a run to its pool's list of runs with free blocks,
+ * or takes it off that list. The lists are guarded by grow_lock in
+ * thread-safe builds.
+ * Returns: No return value.
+ */
+static void partial_link(pool_obj* curr_pool, bump_run* run)
+{
+    run->listed = true;
+    run->prev_partial = NULL;
+    run->next_partial = curr_pool->partial;
+    if (curr_pool->partial != NULL) {
+        curr_pool->partial->prev_partial = run;
+    }
+    curr_pool->partial = run;
+}
 
-    // determine which pool to allocate from
-    size_t optimal_block = UINT16_MAX;
-    uint16_t select_partition = POOLS + 1; // invalid partitition number
+static void partial_unlink(pool_obj* curr_pool, bump_run* run)
+{
+    if (run->prev_partial != NULL) {
+        run->prev_partial->next_partial = run->next_partial;
+    }
+    else {
+        curr_pool->partial = run->next_partial;
+    }
+    if (run->next_partial != NULL) {
+        run->next_partial->prev_partial = run->prev_partial;
+    }
+    run->listed = false;
+}
+
+/*
+ * This function brings a run its pool is not bumping through up to date
+ * after blocks were returned to it. A growth run none of whose blocks are
+ * in use goes back to the reserve, chunk by chunk, where chunk_take finds
+adjacent ones again for runs of several chunks, and any other run with
+ * free blocks is listed for pool_grow to reuse. A run since released or
+ * handed to another pool is left alone. Thread-safe builds hold grow_lock.
+ * Returns: No return value.
+ */
+static void run_settle(pool_t* pool, pool_obj* curr_pool, bump_run* run)
+{
+#ifdef POOL_THREAD_SAFE
+    if (run->owner != curr_pool || run == atomic_load_explicit(&curr_pool->bump, memory_order_relaxed)) {
+        return;
+    }
+    // a refill pinning the run in the meantime settles it again when done
+    size_t live = 0;
+    bool idle = run != &curr_pool->partition
+                && atomic_compare_exchange_strong_explicit(&run->live, &live, RUN_RETIRED,
+                                                           memory_order_acquire, memory_order_relaxed);
+    bool has_free = TAG_PTR(atomic_load_explicit(&run->head, memory_order_relaxed)) != NULL;
+#else
+    if (run->owner != curr_pool || run == curr_pool->bump) {
+        return;
+    }
+    size_t live = run->live;
+    bool idle = run != &curr_pool->partition && live == 0;
+    bool has_free = run->head != NULL;
+#endif
 
-    for (int i = 0; i < POOLS; i++) {
-        // find smallest block size that fits n in a non-full pool
-        if (pool_list[i].block_size <= optimal_block && n <= pool_list[i].block_size 
-        && (pool_list[i].allocated < pool_list[i].max || pool_list[i].head != NULL)) {
-            optimal_block = pool_list[i].block_size;
-            select_partition = i;
+    if (idle) {
+        if (run->listed) {
+            partial_unlink(curr_pool, run);
+        }
+        chunk_entry* head = (chunk_entry*)((uint8_t*)run - offsetof(chunk_entry, own_run));
+        for (size_t c = 0; c < head->span; ++c) {
+            head[c].owner = NULL;
+            head[c].next_free = pool->reserve;
+            pool->reserve = &head[c];
         }
     }
+    else if (live < RUN_RETIRED && has_free && !run->listed) {
+        partial_link(curr_pool, run);
+    }
+}
 
-    if (select_partition == POOLS + 1) {
-      //fprintf(stderr, "Err: No suitable memory pool found\n");
-      return NULL; // all partitions' blocks are too small or full to hold this data
+/*
+ * This function gives a pool whose current run is exhausted a new run to
+ * bump through: one of its own runs with free blocks if it has any, else a
+ * chunk, or several adjacent ones for blocks larger than a chunk, from the
+ * reserve or the never-used end of the range.
+ * Returns: True if the pool has blocks available again, else - False
+ */
+static bool pool_grow(pool_t* pool, pool_obj* curr_pool)
+{
+    if (pool->grow_chunks == 0) {
+        return false;
     }
-    curr_pool = &pool_list[select_partition];
 
-    // memory to be allocated
-    list_node* current = NULL;
+    size_t chunk_size = (size_t)1 << pool->chunk_shift;
+    size_t chunks = (curr_pool->block_size + chunk_size - 1) >> pool->chunk_shift;
 
-    if (curr_pool->head == NULL) {
-      // get position of block to be allocated
-      current = (void *)(curr_pool->pool_start + (curr_pool->allocated * curr_pool->block_size)); 
-      curr_pool->allocated++;
+#ifdef POOL_THREAD_SAFE
+    pthread_mutex_lock(&pool->grow_lock);
+    // another thread may have grown the pool or freed blocks while we waited
+    bump_run* current = atomic_load_explicit(&curr_pool->bump, memory_order_acquire);
+    if (atomic_load_explicit(&current->allocated, memory_order_relaxed) < current->max
+        || TAG_PTR(atomic_load_explicit(&current->head, memory_order_acquire)) != NULL) {
+        pthread_mutex_unlock(&pool->grow_lock);
+        return true;
+    }
+
+    // refills holding a run they loaded earlier may have emptied listed runs
+    bump_run* run = curr_pool->partial;
+    while (run != NULL && TAG_PTR(atomic_load_explicit(&run->head, memory_order_acquire)) == NULL) {
+        partial_unlink(curr_pool, run);
+        run = curr_pool->partial;
+    }
+#else
+    bump_run* current = curr_pool->bump;
+    bump_run* run = curr_pool->partial;
+#endif
+
+    if (run != NULL) {
+        partial_unlink(curr_pool, run);
     }
     else {
-      current = curr_pool->head; // first free block is allocated
-      curr_pool->head = curr_pool->head->next; // list is updated to remove allocated block
-    } 
+        chunk_entry* entry = chunk_take(pool, chunks);
+        if (entry != NULL) {
+            run = &entry->own_run;
+            run->owner = curr_pool;
+            run->start = pool->grow_base + ((size_t)(entry - pool->chunk_table) << pool->chunk_shift);
+            // freshly mapped chunks are zero, released ones hold old blocks
+            run->zeroed = !entry->used && (pool->grow_reserved || pool->heap_zeroed);
+            run->max = (chunks << pool->chunk_shift) / curr_pool->block_size;
+            entry->span = chunks;
+            for (size_t i = 0; i < chunks; ++i) {
+                entry[i].run = run;
+                entry[i].owner = curr_pool;
+                entry[i].used = true;
+            }
+#ifdef POOL_THREAD_SAFE
+            atomic_store_explicit(&run->allocated, 0, memory_order_relaxed);
+            atomic_store_explicit(&run->head, 0, memory_order_relaxed);
+            // refills can pin the run again once they see it set up
+            atomic_store_explicit(&run->live, 0, memory_order_release);
+#else
+            run->allocated = 0;
+            run->head = NULL;
+            run->live = 0;
+#endif
+        }
+    }
 
-    return current; // pointer to memory allocated
+    if (run != NULL) {
+#ifdef POOL_THREAD_SAFE
+        atomic_store_explicit(&curr_pool->bump, run, memory_order_release);
+#else
+        curr_pool->bump = run;
+#endif
+        // blocks freed to the old run while it was current left it alone
+        run_settle(pool, curr_pool, current);
+    }
+
+#ifdef POOL_THREAD_SAFE
+    pthread_mutex_unlock(&pool->grow_lock);
+#endif
+    return run != NULL;
 }
 
 /*
- * This function deallocates memory blocks based on the ptr parameter.
- * The parameter must be a pointer corresponding to a valid place in memory.
- * The newly-freed memory is assigned to the head of the unused memory and
- * will be used next when allocating new memory.
- *
- * O(n) operation where n = POOLS
- *
+ * This function returns a linked segment of n blocks to the run they were
+ * carved from. A run the pool is not bumping through is settled when it
+ * gains its first free block or loses its last block in use, so thread-safe
+ * builds only take grow_lock for those transitions.
  * Returns: No return value.
  */
-void pool_free(void* ptr)
+static void run_return(pool_t* pool, bump_run* run, list_node* first, list_node* last, size_t n)
 {
+    pool_obj* curr_pool = run->owner;
 
-    if (ptr == NULL) {
-      fprintf(stderr, "\tErr: NULL pointer");
-      return; // no processing to be done
+#ifdef POOL_THREAD_SAFE
+    bool was_empty = stack_push(run, first, last);
+    size_t live = atomic_fetch_sub_explicit(&run->live, n, memory_order_acq_rel) - n;
+    if ((was_empty || live == 0) && run != atomic_load_explicit(&curr_pool->bump, memory_order_acquire)) {
+        pthread_mutex_lock(&pool->grow_lock);
+        run_settle(pool, curr_pool, run);
+        pthread_mutex_unlock(&pool->grow_lock);
+    }
+#else
+    last->next = run->head;
+    run->head = first;
+    run->live -= n;
+    if (run != curr_pool->bump) {
+        run_settle(pool, curr_pool, run);
+    }
+#endif
+}
+
+#ifdef POOL_THREAD_SAFE
+/*
+ * This function finds the run a block of an instance belongs to, without
+ * the checks ptr_to_run makes on pointers from callers.
+ * Returns: Pointer to the run
+ */
+static bump_run* block_run(const pool_t* pool, const void* ptr)
+{
+    uintptr_t offset = (uintptr_t)ptr - (uintptr_t)pool->grow_base;
+    if ((offset >> pool->chunk_shift) < pool->grow_chunks) {
+        return pool->chunk_table[offset >> pool->chunk_shift].run;
+    }
+    uint8_t partition = page_partition(pool, ((uintptr_t)ptr - (uintptr_t)pool->heap) >> POOL_PAGE_SHIFT);
+    return (bump_run*)&pool->pool_list[partition].partition;
+}
+
+/*
+ * This function returns a NULL-terminated list of blocks to their runs,
+ * one push for every stretch of blocks carved from the same run.
+ * Returns: No return value.
+ */
+static void blocks_return(pool_t* pool, list_node* first)
+{
+    while (first != NULL) {
+        bump_run* run = block_run(pool, first);
+        list_node* last = first;
+        list_node* next;
+        size_t n = 1;
+        while ((next = NEXT_LOAD(last)) != NULL && block_run(pool, next) == run) {
+            last = next;
+            n++;
+        }
+        run_return(pool, run, first, last, n);
+        first = next;
+    }
+}
+
+/*
+ * This function takes a thread cache for the duration of one operation.
+ * Only a thread emptying the cache of an exhausted pool competes with the
+ * owner, so the exchange is uncontended on the fast path.
+ * Returns: No return value.
+ */
+static void cache_lock(thread_cache* cache)
+{
+    while (atomic_exchange_explicit(&cache->busy, true, memory_order_acquire)) {
+        sched_yield();
+    }
+}
+
+static void cache_unlock(thread_cache* cache)
+{
+    atomic_store_explicit(&cache->busy, false, memory_order_release);
+}
+
+/*
+ * This function moves the blocks past the first keep in the calling
+ * thread's cache for the given pool back to the runs they came from.
+ * Returns: No return value.
+ */
+static void cache_flush(thread_cache* cache, size_t pool_index, uint32_t keep)
+{
+    if (cache->count[pool_index] <= keep) {
+        return;
     }
 
-    pool_obj* curr_pool = NULL;
+    // the blocks past the first keep stay linked together as one segment
+    list_node* tail = NULL;
+    list_node* first = cache->head[pool_index];
+    for (uint32_t i = 0; i < keep; ++i) {
+        tail = first;
+        first = NEXT_LOAD(first);
+    }
+
+    if (tail == NULL) {
+        cache->head[pool_index] = NULL;
+    }
+    else {
+        NEXT_STORE(tail, NULL);
+    }
+    // the fresh blocks are the tail, so only those among the first keep remain
+    uint32_t recycled = cache->count[pool_index] - cache->fresh[pool_index];
+    cache->fresh[pool_index] = keep > recycled ? keep - recycled : 0;
+    cache->count[pool_index] = keep;
 
-    // determine which partition ptr belongs to
-    for (int i = 0; i < POOLS; ++i) {
+    blocks_return(cache->owner, first);
+}
 
-        // determine whether the ptr corresponds to the correct block_size for partition
-        if (ptr >= (void*)pool_list[i].pool_start && ptr < (void*)pool_list[i].pool_end
-                && ((uint8_t*)ptr - pool_list[i].pool_start) % pool_list[i].block_size == 0) {
+/*
+ * Thread exit destructor, hands every cached block back to its pool and
+ * releases the cache.
+ * Returns: No return value.
+ */
+static void cache_release(void* arg)
+{
+    thread_cache* cache = arg;
+    pool_t* pool = cache->owner;
 
-            curr_pool = &pool_list[i];
+    cache_lock(cache);
+    if (cache->generation == pool->generation) {
+        for (size_t i = 0; i < pool->pool_count; ++i) {
+            cache_flush(cache, i, 0);
         }
     }
+    cache_unlock(cache);
 
-    if (curr_pool == NULL) {
-      //fprintf(stderr, "\tErr: Pointer does not correspond to allocated memory\n");
-      return; // ptr not found - fail case
+    pthread_mutex_lock(&pool->cache_lock);
+    thread_cache** link = &pool->caches;
+    while (*link != cache) {
+        link = &(*link)->next;
     }
+    *link = cache->next;
+    pthread_mutex_unlock(&pool->cache_lock);
+    free(cache);
+}
 
-    list_node* ptr_free = (list_node*)ptr;
+#ifdef POOL_STATIC_CONFIG
+static pthread_once_t g_static_cache_once = PTHREAD_ONCE_INIT;
+
+/*
+ * This function creates the cache key of the statically laid out default instance.
+ * Returns: No return value.
+ */
+static void static_cache_setup(void)
+{
+    if (pthread_key_create(&g_default_pool.cache_key, cache_release) == 0) {
+        atomic_store_explicit(&g_default_pool.cache_ready, true, memory_order_release);
+    }
+}
+#endif
+
+/*
+ * This function returns the calling thread's cache for an instance,
+ * creating it on first use and emptying it if its blocks were handed out
+ * before the instance was last laid out.
+ * Returns: Pointer to the calling thread's cache, NULL if it cannot be created
+ */
+static thread_cache* cache_get(pool_t* pool)
+{
+    bool ready = atomic_load_explicit(&pool->cache_ready, memory_order_acquire);
+#ifdef POOL_STATIC_CONFIG
+    // the default instance is never set up, its key is made on first use
+    if (!ready && pool == &g_default_pool && pthread_once(&g_static_cache_once, static_cache_setup) == 0) {
+        ready = atomic_load_explicit(&pool->cache_ready, memory_order_acquire);
+    }
+#endif
+    if (!ready) {
+        return NULL;
+    }
+
+    thread_cache* cache = pthread_getspecific(pool->cache_key);
+
+    if (cache == NULL) {
+        cache = calloc(1, sizeof(thread_cache));
+        if (cache == NULL) {
+            return NULL;
+        }
+        cache->owner = pool;
+        cache->generation = pool->generation;
+
+        pthread_mutex_lock(&pool->cache_lock);
+        cache->next = pool->caches;
+        pool->caches = cache;
+        pthread_mutex_unlock(&pool->cache_lock);
+        pthread_setspecific(pool->cache_key, cache);
+    }
+    else if (cache->generation != pool->generation) {
+        cache_lock(cache);
+        memset(cache->head, 0, sizeof(cache->head));
+        memset(cache->count, 0, sizeof(cache->count));
+        memset(cache->fresh, 0, sizeof(cache->fresh));
+        cache->generation = pool->generation;
+        cache_unlock(cache);
+    }
+    return cache;
+}
+
+/*
+ * This function empties every other thread's cache of one pool onto its
+ * shared free list, for a pool that is exhausted and cannot grow while
+ * blocks sit idle in those caches. The calling thread's cache is released
+ * meanwhile, so two threads doing this never wait on each other.
+ * Returns: True if any block was moved to the shared free list
+ */
+static bool cache_steal(thread_cache* cache, size_t pool_index)
+{
+    pool_t* pool = cache->owner;
+    bool moved = false;
+
+    cache_unlock(cache);
+    pthread_mutex_lock(&pool->cache_lock);
+    for (thread_cache* other = pool->caches; other != NULL; other = other->next) {
+        if (other == cache) {
+            continue;
+        }
+        cache_lock(other);
+        if (other->generation == pool->generation && other->count[pool_index] > 0) {
+            cache_flush(other, pool_index, 0);
+            moved = true;
+        }
+        cache_unlock(other);
+    }
+    pthread_mutex_unlock(&pool->cache_lock);
+    cache_lock(cache);
+    return moved;
+}
+
+/*
+ * This function refills the calling thread's cache for one pool with up to
+ * one batch of blocks, carved from the pool's current run and topped up
+ * from that run's free list. The pool grows when both are empty, and once
+ * it cannot, takes back the blocks cached by other threads.
+ * Returns: Number of blocks added to the cache
+ */
+static uint32_t cache_refill(thread_cache* cache, size_t pool_index)
+{
+    pool_t* pool = cache->owner;
+    pool_obj* curr_pool = &pool->pool_list[pool_index];
+    uint32_t batch = curr_pool->cache_batch;
+    list_node* blocks = NULL;
+    uint32_t taken;
+    uint32_t fresh = 0;
+
+    do {
+        taken = 0;
+        bump_run* run = atomic_load_explicit(&curr_pool->bump, memory_order_acquire);
+        if (!run_pin(run)) {
+            continue; // released since it was loaded, the pool has moved on
+        }
+
+        if (run->owner == curr_pool) {
+            // never-used blocks are linked in address order behind the recycled ones
+            size_t first = 0;
+            taken = bump_claim(run, batch, &first);
+            uint8_t* block = run->start + (first * curr_pool->block_size);
+            for (uint32_t i = taken; i > 0; --i) {
+                list_node* node = (list_node*)(block + (i - 1) * curr_pool->block_size);
+                NEXT_STORE(node, blocks);
+                blocks = node;
+            }
+            fresh = run->zeroed ? taken : 0;
+
+            list_node* node;
+            while (taken < batch && (node = stack_pop(run)) != NULL) {
+                NEXT_STORE(node, blocks);
+                blocks = node;
+                taken++;
+            }
+        }
+
+        // the pin turns into the blocks taken, a run left idle is settled
+        size_t live = atomic_fetch_add_explicit(&run->live, (size_t)taken - 1, memory_order_acq_rel)
+                      + taken - 1;
+        if (live == 0) {
+            pool_obj* run_pool = run->owner;
+            pthread_mutex_lock(&pool->grow_lock);
+            run_settle(pool, run_pool, run);
+            pthread_mutex_unlock(&pool->grow_lock);
+        }
+    } while (taken == 0 && (pool_grow(cache->owner, curr_pool) || cache_steal(cache, pool_index)));
+
+    cache->head[pool_index] = blocks;
+    cache->count[pool_index] = taken;
+    cache->fresh[pool_index] = fresh;
+    return taken;
+}
+
+/*
+ * Thread-safe allocation path, pops from the calling thread's cache and
+ * only goes to the shared pool when that cache is empty. Spills into larger
+ * pools the same way as the single-threaded path, once growth has failed.
+ * Never-used blocks sit at the end of the cached list, behind every
+ * recycled one, so a block is known to be zero once only those are left.
+ * Returns: Pointer to allocated memory if successful, NULL if failed
+ */
+static void* cache_malloc(pool_t* pool, size_t pool_index, size_t align_mask, bool* zeroed,
+                          size_t* actual)
+{
+    thread_cache* cache = cache_get(pool);
+    list_node* current = NULL;
+
+    if (cache == NULL) {
+        return NULL;
+    }
 
-    ptr_free->next = curr_pool->head; // freed memory becomes new head of list for partition
-    curr_pool->head = ptr_free;
+    cache_lock(cache);
+    for (; pool_index < pool->pool_count; ++pool_index) {
+        if ((pool->pool_list[pool_index].block_size & align_mask) != 0) {
+            continue; // stride does not keep blocks aligned
+        }
+        if (cache->count[pool_index] > 0 || cache_refill(cache, pool_index) > 0) {
+            current = cache->head[pool_index];
+            cache->head[pool_index] = NEXT_LOAD(current);
+            if (zeroed != NULL) {
+                *zeroed = cache->count[pool_index] <= cache->fresh[pool_index];
+                if (*zeroed) {
+                    NEXT_STORE(current, NULL); // only the link was written to a never-used block
+                }
+            }
+            if (actual != NULL) {
+                *actual = pool->pool_list[pool_index].block_size;
+            }
+            if (cache->fresh[pool_index] == cache->count[pool_index]) {
+                cache->fresh[pool_index]--;
+            }
+            cache->count[pool_index]--;
+            break;
+        }
+    }
+    cache_unlock(cache);
+    return current;
+}
+
+/*
+ * Thread-safe free path, pushes onto the calling thread's cache and hands
+ * a batch back to the pool once the cache holds more than two batches.
+ * Returns: No return value.
+ */
+static void cache_free(pool_t* pool, bump_run* run, list_node* ptr_free)
+{
+    thread_cache* cache = cache_get(pool);
+    size_t pool_index = (pool_obj*)run->owner - pool->pool_list;
+
+    if (cache == NULL) {
+        run_return(pool, run, ptr_free, ptr_free, 1);
+        return;
+    }
+
+    uint32_t batch = pool->pool_list[pool_index].cache_batch;
+    cache_lock(cache);
+    NEXT_STORE(ptr_free, cache->head[pool_index]);
+    cache->head[pool_index] = ptr_free;
+    if (++cache->count[pool_index] > 2 * batch) {
+        cache_flush(cache, pool_index, batch);
+    }
+    cache_unlock(cache);
+}
+
+/*
+ * Thread-safe bulk allocation path, unlinks blocks from the calling
+ * thread's cache and refills it a batch at a time. Spills into larger
+ * pools like cache_malloc once a pool cannot grow.
+ * Returns: Number of blocks written to out
+ */
+static size_t cache_malloc_bulk(pool_t* pool, size_t pool_index, void** out, size_t count)
+{
+    thread_cache* cache = cache_get(pool);
+    size_t done = 0;
+
+    if (cache == NULL) {
+        return 0;
+    }
+
+    cache_lock(cache);
+    while (done < count && pool_index < pool->pool_count) {
+        if (cache->count[pool_index] == 0 && cache_refill(cache, pool_index) == 0) {
+            pool_index++;
+            continue;
+        }
+
+        list_node* current = cache->head[pool_index];
+        uint32_t cached = cache->count[pool_index];
+        while (cached > 0 && done < count) {
+            out[done++] = current;
+            current = NEXT_LOAD(current);
+            cached--;
+        }
+        cache->head[pool_index] = current;
+        cache->count[pool_index] = cached;
+        if (cache->fresh[pool_index] > cached) {
+            cache->fresh[pool_index] = cached;
+        }
+    }
+    cache_unlock(cache);
+    return done;
+}
+
+/*
+ * Thread-safe bulk free path, prepends a linked segment of n blocks of one
+ * run to the calling thread's cache. Segments larger than the cache holds
+ * go straight back to the run in one push.
+ * Returns: No return value.
+ */
+static void cache_free_bulk(pool_t* pool, bump_run* run, list_node* first, list_node* last, size_t n)
+{
+    thread_cache* cache = cache_get(pool);
+    size_t pool_index = (pool_obj*)run->owner - pool->pool_list;
+    uint32_t batch = pool->pool_list[pool_index].cache_batch;
+
+    if (cache == NULL || n > 2 * batch) {
+        run_return(pool, run, first, last, n);
+        return;
+    }
+
+    cache_lock(cache);
+    NEXT_STORE(last, cache->head[pool_index]);
+    cache->head[pool_index] = first;
+    cache->count[pool_index] += (uint32_t)n;
+    if (cache->count[pool_index] > 2 * batch) {
+        cache_flush(cache, pool_index, batch);
+    }
+    cache_unlock(cache);
+}
+#endif
+
+#ifdef POOL_TRACE
+// pointer of a live block and the id its trace events carry
+typedef struct {
+    const void* ptr;
+    uint32_t id;
+} trace_slot;
+
+static FILE* g_trace_file;           // trace being written, NULL while not recording
+static uint64_t g_trace_epoch;       // clock reading timestamps are relative to
+static uint32_t g_trace_next_id;     // id of the next allocation, 0 is never used
+static trace_slot* g_trace_slots;    // open-addressed table of live blocks
+static size_t g_trace_capacity;      // slots in g_trace_slots, a power of two
+static size_t g_trace_live;          // live blocks in g_trace_slots
+#ifdef POOL_THREAD_SAFE
+static pthread_mutex_t g_trace_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/*
+ * This function reads a monotonic clock.
+ * Returns: Current time in nanoseconds
+ */
+static uint64_t trace_clock(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * This function finds the slot of a pointer, or the empty slot it belongs in.
+ * Returns: Pointer to the slot
+ */
+static trace_slot* trace_find(const void* ptr)
+{
+    size_t mask = g_trace_capacity - 1;
+    size_t i = ((uintptr_t)ptr >> 3) * 0x9E3779B97F4A7C15u >> 20 & mask;
+    while (g_trace_slots[i].ptr != NULL && g_trace_slots[i].ptr != ptr) {
+        i = (i + 1) & mask;
+    }
+    return &g_trace_slots[i];
+}
+
+/*
+ * This function doubles the table of live blocks.
+ * Returns: True - if the table grew, else - False
+ */
+static bool trace_grow(void)
+{
+    trace_slot* old = g_trace_slots;
+    size_t old_capacity = g_trace_capacity;
+
+    trace_slot* slots = calloc(old_capacity * 2, sizeof(trace_slot));
+    if (slots == NULL) {
+        return false;
+    }
+    g_trace_slots = slots;
+    g_trace_capacity = old_capacity * 2;
+    for (size_t i = 0; i < old_capacity; ++i) {
+        if (old[i].ptr != NULL) {
+            *trace_find(old[i].ptr) = old[i];
+        }
+    }
+    free(old);
+    return true;
+}
+
+/*
+ * This function appends one event to the trace.
+ * Returns: No return value.
+ */
+static void trace_write(uint8_t op, uint32_t id, size_t size)
+{
+    pool_trace_event event = {.time = trace_clock() - g_trace_epoch, .size = size, .id = id, .op = op};
+    fwrite(&event, sizeof(event), 1, g_trace_file);
+}
+
+/*
+ * This function records the allocation of n bytes at ptr, giving the
+ * block the next id. Failed allocations are not recorded.
+ * Returns: No return value.
+ */
+static void trace_alloc(const void* ptr, size_t n)
+{
+    if (ptr == NULL) {
+        return;
+    }
+
+#ifdef POOL_THREAD_SAFE
+    pthread_mutex_lock(&g_trace_lock);
+#endif
+    // the table is kept at most half full
+    if (g_trace_file != NULL && ((g_trace_live + 1) * 2 <= g_trace_capacity || trace_grow())) {
+        trace_slot* slot = trace_find(ptr);
+        slot->ptr = ptr;
+        slot->id = g_trace_next_id++;
+        g_trace_live++;
+        trace_write(POOL_TRACE_MALLOC, slot->id, n);
+    }
+#ifdef POOL_THREAD_SAFE
+    pthread_mutex_unlock(&g_trace_lock);
+#endif
+}
+
+/*
+ * This function records the free of the block at ptr. Blocks allocated
+ * before recording started are not recorded.
+ * Returns: No return value.
+ */
+static void trace_free(const void* ptr)
+{
+#ifdef POOL_THREAD_SAFE
+    pthread_mutex_lock(&g_trace_lock);
+#endif
+    trace_slot* slot = g_trace_file != NULL ? trace_find(ptr) : NULL;
+    if (slot != NULL && slot->ptr != NULL) {
+        trace_write(POOL_TRACE_FREE, slot->id, 0);
+
+        // backward-shift deletion keeps every probe sequence unbroken
+        size_t mask = g_trace_capacity - 1;
+        size_t hole = slot - g_trace_slots;
+        size_t i = hole;
+        for (;;) {
+            i = (i + 1) & mask;
+            if (g_trace_slots[i].ptr == NULL) {
+                break;
+            }
+            size_t home = ((uintptr_t)g_trace_slots[i].ptr >> 3) * 0x9E3779B97F4A7C15u >> 20 & mask;
+            if (((i - home) & mask) >= ((i - hole) & mask)) {
+                g_trace_slots[hole] = g_trace_slots[i];
+                hole = i;
+            }
+        }
+        g_trace_slots[hole].ptr = NULL;
+        g_trace_live--;
+    }
+#ifdef POOL_THREAD_SAFE
+    pthread_mutex_unlock(&g_trace_lock);
+#endif
+}
+#else
+#define trace_alloc(ptr, n) ((void)0)
+#define trace_free(ptr) ((void)0)
+#endif
+
+/*
+ * This function starts recording every allocation and free to a trace
+ * file, replacing any trace already being recorded.
+ * Returns: True - if recording started, else - False
+ */
+bool pool_trace_start(const char* path)
+{
+#ifdef POOL_TRACE
+    pool_trace_stop();
+
+    FILE* file = fopen(path, "wb");
+    trace_slot* slots = calloc(1024, sizeof(trace_slot));
+    pool_trace_header header = {.magic = POOL_TRACE_MAGIC, .version = POOL_TRACE_VERSION};
+    if (file == NULL || slots == NULL || fwrite(&header, sizeof(header), 1, file) != 1) {
+        if (file != NULL) {
+            fclose(file);
+        }
+        free(slots);
+        return false;
+    }
+
+#ifdef POOL_THREAD_SAFE
+    pthread_mutex_lock(&g_trace_lock);
+#endif
+    g_trace_slots = slots;
+    g_trace_capacity = 1024;
+    g_trace_live = 0;
+    g_trace_next_id = 1;
+    g_trace_epoch = trace_clock();
+    g_trace_file = file;
+#ifdef POOL_THREAD_SAFE
+    pthread_mutex_unlock(&g_trace_lock);
+#endif
+    return true;
+#else
+    (void)path;
+    return false; // built without POOL_TRACE
+#endif
+}
+
+/*
+ * This function stops recording and closes the trace file.
+ * Returns: No return value.
+ */
+void pool_trace_stop(void)
+{
+#ifdef POOL_TRACE
+#ifdef POOL_THREAD_SAFE
+    pthread_mutex_lock(&g_trace_lock);
+#endif
+    if (g_trace_file != NULL) {
+        fclose(g_trace_file);
+    }
+    free(g_trace_slots);
+    g_trace_file = NULL;
+    g_trace_slots = NULL;
+    g_trace_capacity = 0;
+    g_trace_live = 0;
+#ifdef POOL_THREAD_SAFE
+    pthread_mutex_unlock(&g_trace_lock);
+#endif
+#endif
+}
+
+/*
+ * This function releases the growth range and chunk table of an instance.
+ * Returns: No return value.
+ */
+static void grow_release(pool_t* pool)
+{
+    if (pool->grow_chunks != 0) {
+        if (pool->grow_reserved) {
+            munmap(pool->grow_base, pool->grow_chunks << pool->chunk_shift);
+        }
+        munmap(pool->chunk_table, pool->grow_chunks * sizeof(chunk_entry));
+    }
+    pool->grow_base = NULL;
+    pool->grow_chunks = 0;
+    pool->grow_next = 0;
+    pool->grow_reserved = false;
+    pool->chunk_table = NULL;
+    pool->reserve = NULL;
+}
+
+/*
+ * This function releases the heap and page map of an instance if they
+ * were obtained by pool_setup. Caller-owned and static memory is kept.
+ * Returns: No return value.
+ */
+static void heap_release(pool_t* pool)
+{
+    if (pool->heap_mapped) {
+        munmap(pool->heap, pool->heap_size);
+    }
+#ifdef POOL_STATIC_CONFIG
+    free(pool->page_map); // the default instance is never set up, so never released
+#else
+    if (pool->page_map != g_page_map) {
+        free(pool->page_map);
+    }
+#endif
+    pool->heap = NULL;
+    pool->heap_size = 0;
+    pool->heap_mapped = false;
+    pool->page_map = NULL;
+}
+
+/*
+ * This function multiplies two sizes, failing instead of wrapping around.
+ * Returns: True - if the product fits in a size_t, else - False
+ */
+static bool checked_mul(size_t a, size_t b, size_t* product)
+{
+    if (a != 0 && b > SIZE_MAX / a) {
+        return false;
+    }
+    *product = a * b;
+    return true;
+}
+
+/*
+ * This function decides how many heap bytes each block size receives.
+ * Explicit block counts reserve exactly the pages those blocks need,
+ * weights split the heap in proportion, and without either every block
+ * size gets an equal share. Shares are whole pages so the page map stays
+ * exact, and the result is indexed like config->block_sizes.
+ * Returns: True - if the shares fit in the heap, else - False
+ */
+static bool partition_sizes(const pool_config* config, size_t heap_size, size_t* partitions)
+{
+    size_t count = config->block_size_count;
+    size_t pages = heap_size >> POOL_PAGE_SHIFT;
+
+    if (config->block_counts != NULL && config->block_weights != NULL) {
+        return false; // ambiguous, only one of the two may be given
+    }
+
+    if (config->block_counts != NULL) {
+        size_t used = 0;
+        for (size_t i = 0; i < count; ++i) {
+            size_t bytes;
+            if (!checked_mul(config->block_counts[i], config->block_sizes[i], &bytes)) {
+                return false;
+            }
+            size_t needed = (bytes >> POOL_PAGE_SHIFT) + ((bytes & (POOL_PAGE_SIZE - 1)) != 0);
+            if (needed > pages - used) {
+                return false; // blocks requested do not fit in the heap
+            }
+            used += needed;
+            partitions[i] = needed << POOL_PAGE_SHIFT;
+        }
+    }
+    else if (config->block_weights != NULL) {
+        size_t weight_sum = 0;
+        for (size_t i = 0; i < count; ++i) {
+            if (config->block_weights[i] > SIZE_MAX - weight_sum) {
+                return false;
+            }
+            weight_sum += config->block_weights[i];
+        }
+        if (weight_sum == 0) {
+            return false;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            size_t share;
+            if (checked_mul(pages, config->block_weights[i], &share)) {
+                share /= weight_sum;
+            }
+            else {
+                share = pages / weight_sum * config->block_weights[i]; // slightly under, never over
+            }
+            partitions[i] = share << POOL_PAGE_SHIFT;
+        }
+    }
+    else {
+        // Assumption - user wants equal-sized partitions for all block sizes
+        for (size_t i = 0; i < count; ++i) {
+            partitions[i] = (pages / count) << POOL_PAGE_SHIFT;
+        }
+    }
+    return true;
+}
+
+/*
+ * This function lays out the pools of an instance from a configuration.
+ * The heap is the caller's buffer trimmed to whole pages, or a fresh
+ * mapping of heap_size bytes, or HEAP_SIZE bytes when neither is given.
+ * A non-zero chunk_size reserves grow_limit bytes of address space that
+ * exhausted pools map chunks from.
+ * A non-zero slab_size instead leaves every partition empty and cuts the
+ * heap into slabs that pools take as they need them.
+ * The size of each partition is defined by partition_sizes and each pool
+ * is intitalized with its parameters. Pools are laid out in ascending block size order, each
+ * partition starting on a page boundary, and the lookup tables used by
+ * malloc and free are rebuilt. The instance is left untouched if the
+ * configuration is invalid or memory cannot be obtained.
+ * Returns: True - if initialization is successful, else - False
+ */
+static bool pool_setup(pool_t* pool, const pool_config* config)
+{
+    size_t block_size_count = config->block_size_count;
+    const size_t* block_sizes = config->block_sizes;
+
+#ifdef POOL_STATIC_CONFIG
+    if (pool == &g_default_pool) {
+        return false; // laid out at compile time, see POOL_STATIC_POOLS
+    }
+#endif
+
+    // upper limit surpassed or negative number of blocks
+    if (block_size_count > POOLS || block_size_count == 0) {
+        //fprintf(stderr, "Err: Invalid parameters\n");
+        return false;
+    }
+
+    uint8_t* heap = config->heap;
+    size_t heap_size = config->heap_size;
+
+    if (heap != NULL) {
+        // caller buffers are trimmed to whole pages so the page map stays exact
+        size_t skip = -(uintptr_t)heap & (POOL_PAGE_SIZE - 1);
+        if (heap_size < skip || (uintptr_t)heap + heap_size < (uintptr_t)heap) {
+            return false; // too small to hold a page, or wraps the address space
+        }
+        heap += skip;
+        heap_size = (heap_size - skip) & ~(size_t)(POOL_PAGE_SIZE - 1);
+    }
+    else if (heap_size == 0) {
+        heap_size = HEAP_SIZE;
+    }
+    else {
+        heap_size = (heap_size + POOL_PAGE_SIZE - 1) & ~(size_t)(POOL_PAGE_SIZE - 1);
+        if (heap_size < config->heap_size) {
+            return false; // rounding up wrapped around
+        }
+    }
+
+    size_t partitions[POOLS];
+    if (config->slab_size != 0) {
+        if (config->chunk_size != 0 || config->block_counts != NULL || config->block_weights != NULL) {
+            return false; // slabs replace both fixed partitions and growth
+        }
+        memset(partitions, 0, sizeof(partitions));
+    }
+    else if (!partition_sizes(config, heap_size, partitions)) {
+        return false;
+    }
+
+    // determine if any block_sizes are invalid before touching the pools
+    size_t sorted[POOLS]; // indices into block_sizes, ascending by block size
+    for (size_t i = 0; i < block_size_count; ++i) {
+        size_t limit = config->slab_size != 0 ? heap_size : partitions[i];
+        if (block_sizes[i] > limit || block_sizes[i] == 0) {
+          return false;
+        }
+
+        // insertion sort so neighbouring pools are the next larger block size
+        size_t j = i;
+        while (j > 0 && block_sizes[sorted[j - 1]] > block_sizes[i]) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = i;
+    }
+
+#ifdef POOL_THREAD_SAFE
+    if (!pool->cache_ready) {
+        if (pthread_key_create(&pool->cache_key, cache_release) != 0) {
+            return false;
+        }
+        pool->cache_ready = true;
+    }
+#endif
+
+    // reserve the growth range, chunks are only made accessible by pool_grow
+    size_t chunk_shift = MIN_CHUNK_SHIFT;
+    size_t grow_chunks = 0;
+    uint8_t* grow_base = NULL;
+    chunk_entry* chunk_table = NULL;
+
+    if (config->chunk_size != 0 || config->slab_size != 0) {
+        size_t unit = config->slab_size != 0 ? config->slab_size : config->chunk_size;
+        while (chunk_shift < sizeof(size_t) * 8 - 1 && ((size_t)1 << chunk_shift) < unit) {
+            chunk_shift++;
+        }
+        if (config->slab_size != 0) {
+            grow_chunks = heap_size >> chunk_shift; // slabs are the heap itself
+        }
+        else {
+            grow_chunks = (config->grow_limit != 0 ? config->grow_limit : GROW_LIMIT) >> chunk_shift;
+        }
+        if (grow_chunks == 0) {
+            return false; // limit smaller than a single chunk
+        }
+
+        if (config->chunk_size != 0) {
+            grow_base = mmap(NULL, grow_chunks << chunk_shift, PROT_NONE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        }
+        chunk_table = mmap(NULL, grow_chunks * sizeof(chunk_entry), PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (grow_base == MAP_FAILED || chunk_table == MAP_FAILED) {
+            if (grow_base != MAP_FAILED && grow_base != NULL) {
+                munmap(grow_base, grow_chunks << chunk_shift);
+            }
+            if (chunk_table != MAP_FAILED) {
+                munmap(chunk_table, grow_chunks * sizeof(chunk_entry));
+            }
+            return false;
+        }
+    }
+
+    // obtain the heap and page map, the default instance keeps its static arrays
+    bool heap_mapped = false;
+    uint8_t* page_map = NULL;
+
+#ifndef POOL_STATIC_CONFIG
+    if (heap == NULL && pool == &g_default_pool && heap_size == HEAP_SIZE) {
+        heap = g_pool_heap;
+        page_map = g_page_map;
+    }
+#endif
+    if (page_map == NULL) {
+        if (heap == NULL) {
+            heap = mmap(NULL, heap_size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            if (heap == MAP_FAILED) {
+                heap = NULL;
+            }
+            heap_mapped = true;
+        }
+        page_map = heap != NULL ? malloc(heap_size >> POOL_PAGE_SHIFT) : NULL;
+        if (page_map == NULL) {
+            if (heap_mapped && heap != NULL) {
+                munmap(heap, heap_size);
+            }
+            if (grow_chunks != 0) {
+                if (grow_base != NULL) {
+                    munmap(grow_base, grow_chunks << chunk_shift);
+                }
+                munmap(chunk_table, grow_chunks * sizeof(chunk_entry));
+            }
+            return false;
+        }
+    }
+
+#ifdef POOL_THREAD_SAFE
+    pool->generation++; // blocks cached by any thread belong to the old layout
+#endif
+
+    // drop the previous heap and page map, memory reused by the new layout is kept
+    if (pool->heap == heap) {
+        pool->heap = NULL;
+    }
+    if (pool->page_map == page_map) {
+        pool->page_map = NULL;
+    }
+    heap_release(pool);
+    grow_release(pool);
+    pool->heap = heap;
+    pool->heap_size = heap_size;
+    pool->heap_mapped = heap_mapped;
+    // fresh mappings and the static heap before its first layout read as zero
+#ifdef POOL_STATIC_CONFIG
+    pool->heap_zeroed = heap_mapped;
+#else
+    pool->heap_zeroed = heap_mapped || (heap == g_pool_heap && !g_pool_heap_used);
+    if (heap == g_pool_heap) {
+        g_pool_heap_used = true;
+    }
+#endif
+    pool->page_map = page_map;
+    pool->grow_base = config->slab_size != 0 ? heap : grow_base;
+    pool->grow_chunks = grow_chunks;
+    pool->grow_reserved = config->chunk_size != 0;
+    pool->chunk_shift = chunk_shift;
+    pool->chunk_table = chunk_table;
+
+    pool_obj* pool_list = pool->pool_list;
+    uint8_t* current_addr = pool->heap;
+    memset(pool->page_map, NO_POOL, heap_size >> POOL_PAGE_SHIFT);
+
+    for (size_t i = 0; i < block_size_count; ++i) {
+        size_t partition = partitions[sorted[i]];
+
+        // define pool for specific block size
+        pool_list[i].pool_start = current_addr;
+        pool_list[i].partial = NULL;
+        pool_list[i].block_size = block_sizes[sorted[i]];
+        pool_list[i].block_low_mask = BLOCK_LOW(pool_list[i].block_size) - 1;
+        pool_list[i].block_inverse = BLOCK_INVERSE(pool_list[i].block_size);
+        pool_list[i].block_limit = SIZE_MAX / BLOCK_ODD(pool_list[i].block_size);
+        pool_list[i].partition.owner = &pool_list[i];
+        pool_list[i].partition.start = current_addr;
+        pool_list[i].partition.listed = false;
+        pool_list[i].partition.allocated = 0;
+        pool_list[i].partition.head = 0;
+        pool_list[i].partition.live = 0;
+        pool_list[i].partition.zeroed = pool->heap_zeroed;
+        pool_list[i].partition.max = partition / pool_list[i].block_size; // any excess partial block is ignored
+        pool_list[i].bump = &pool_list[i].partition;
+        pool_list[i].pool_end = current_addr + (pool_list[i].partition.max * pool_list[i].block_size);
+#ifdef POOL_THREAD_SAFE
+        pool_list[i].cache_batch = CACHE_BATCH(grow_chunks != 0 ? 0 : pool_list[i].partition.max);
+#endif
+
+        size_t first_page = (current_addr - pool->heap) >> POOL_PAGE_SHIFT;
+        size_t end_page = (pool_list[i].pool_end - pool->heap + POOL_PAGE_SIZE - 1) >> POOL_PAGE_SHIFT;
+        memset(&pool->page_map[first_page], i, end_page - first_page);
+
+        current_addr += partition;
+    }
+    pool->pool_count = block_size_count;
+
+    // granule g holds requests ((g - 1) * SIZE_GRANULE, g * SIZE_GRANULE]
+    size_t index = 0;
+    for (size_t g = 1; g < sizeof(pool->size_class_table); ++g) {
+        size_t smallest = (g - 1) * SIZE_GRANULE + 1;
+        while (index < pool->pool_count && pool_list[index].block_size < smallest) {
+            index++;
+        }
+        pool->size_class_table[g] = index;
+    }
+    pool->size_class_table[0] = pool->pool_count;
+
+    // successful initialization of pools
+    return true;
+}
+
+/*
+ * This function creates an allocator instance with its own heap and pools,
+ * sharing no memory with the default instance or any other instance.
+ * Returns: Pointer to the new instance, NULL if the configuration is
+ * invalid or memory could not be obtained
+ */
+pool_t* pool_create(const pool_config* config)
+{
+    if (config == NULL) {
+        return NULL;
+    }
+
+    // rounded to whole cache lines so no other object shares the last one
+    size_t size = (sizeof(pool_t) + CACHE_LINE - 1) & ~(size_t)(CACHE_LINE - 1);
+    pool_t* pool = aligned_alloc(CACHE_LINE, size);
+    if (pool == NULL) {
+        return NULL;
+    }
+
+    memset(pool, 0, sizeof(pool_t));
+#ifdef POOL_THREAD_SAFE
+    pthread_mutex_init(&pool->cache_lock, NULL);
+    pthread_mutex_init(&pool->grow_lock, NULL);
+#endif
+
+    if (!pool_setup(pool, config)) {
+        pool_destroy(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+/*
+ * This function releases an instance created by pool_create along with
+ * every block still allocated from it.
+ * Returns: No return value.
+ */
+void pool_destroy(pool_t* pool)
+{
+    if (pool == NULL || pool == &g_default_pool) {
+        return;
+    }
+
+#ifdef POOL_THREAD_SAFE
+    if (pool->cache_ready) {
+        pthread_key_delete(pool->cache_key);
+    }
+    while (pool->caches != NULL) {
+        thread_cache* cache = pool->caches;
+        pool->caches = cache->next;
+        free(cache);
+    }
+    pthread_mutex_destroy(&pool->cache_lock);
+    pthread_mutex_destroy(&pool->grow_lock);
+#endif
+
+    heap_release(pool);
+    grow_release(pool);
+    free(pool);
+}
+
+/*
+ * This function takes every lock of an instance, for a pthread_atfork
+ * prepare handler. Locks are taken in the order the allocator nests them:
+ * the list of caches, each thread's cache, then growth.
+ * Returns: No return value.
+ */
+void pool_lock_all(pool_t* pool)
+{
+#ifdef POOL_THREAD_SAFE
+    pthread_mutex_lock(&pool->cache_lock);
+    for (thread_cache* cache = pool->caches; cache != NULL; cache = cache->next) {
+        cache_lock(cache);
+    }
+    pthread_mutex_lock(&pool->grow_lock);
+#else
+    (void)pool;
+#endif
+}
+
+/*
+ * This function releases the locks taken by pool_lock_all. In a forked
+ * child the threads that held them are gone, so they are set up afresh.
+ * Returns: No return value.
+ */
+void pool_unlock_all(pool_t* pool, bool child)
+{
+#ifdef POOL_THREAD_SAFE
+    if (child) {
+        pthread_mutex_init(&pool->grow_lock, NULL);
+        pthread_mutex_init(&pool->cache_lock, NULL);
+    }
+    else {
+        pthread_mutex_unlock(&pool->grow_lock);
+    }
+    for (thread_cache* cache = pool->caches; cache != NULL; cache = cache->next) {
+        cache_unlock(cache);
+    }
+    if (!child) {
+        pthread_mutex_unlock(&pool->cache_lock);
+    }
+#else
+    (void)pool;
+    (void)child;
+#endif
+}
+
+/*
+ * This function takes in a pointer to an array of block sizes as well
+ * as the count of how many block sizes there are and lays out the default
+ * instance with them. Any block still allocated from the default instance
+ * becomes invalid.
+ * Returns: True - if initialization is successful, else - False
+ */
+bool pool_init(const size_t* block_sizes, size_t block_size_count)
+{
+    pool_config config = {
+        .block_sizes = block_sizes,
+        .block_size_count = block_size_count,
+    };
+    return pool_setup(&g_default_pool, &config);
+}
+
+/*
+ * This function lays out the default instance from a full configuration,
+ * which allows it to use a caller-owned or mapped heap of any size. Any
+ * block still allocated from the default instance becomes invalid.
+ * Returns: True - if initialization is successful, else - False
+ */
+bool pool_init_config(const pool_config* config)
+{
+    return config != NULL && pool_setup(&g_default_pool, config);
+}
+
+/*
+ * This function maps a request size to the smallest pool whose block size
+ * can hold it. Sizes covered by the lookup table take one indexed load,
+ * larger sizes fall back to a binary search over the sorted pools. The
+ * default instance of a POOL_STATIC_CONFIG build uses pool_static_class.
+ * Returns: Index of best-fit pool, pool_count if no block size is big enough
+ */
+static size_t size_to_pool(const pool_t* pool, size_t n)
+{
+    size_t i;
+
+#ifdef POOL_STATIC_CONFIG
+    if (pool == &g_default_pool) {
+        return pool_static_class(n, 1);
+    }
+#endif
+
+    if (n <= SIZE_TABLE_MAX) {
+        i = pool->size_class_table[(n + SIZE_GRANULE - 1) >> SIZE_GRANULE_SHIFT];
+        // block sizes that are not a multiple of the granule can split one
+        while (i < pool->pool_count && pool->pool_list[i].block_size < n) {
+            i++;
+        }
+        return i;
+    }
+
+    size_t lo = 0;
+    size_t hi = pool->pool_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (pool->pool_list[mid].block_size < n) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/*
+ * This function takes a block from the pool at select_partition, or from
+ * the next larger pool that has one if it is full and cannot grow. Pools
+ * whose block size has any align_mask bit set are passed over. If zeroed
+ * is not NULL it reports whether the block is known to read as zero, and
+ * if actual is not NULL it receives the block size.
+ * Returns: Pointer to allocated memory if successful, NULL if failed
+ */
+static void* pool_take(pool_t* pool, size_t select_partition, size_t align_mask, bool* zeroed,
+                       size_t* actual)
+{
+#ifdef POOL_THREAD_SAFE
+    return cache_malloc(pool, select_partition, align_mask, zeroed, actual);
+#else
+    pool_obj* pool_list = pool->pool_list;
+
+    while (select_partition < pool->pool_count
+    && ((pool_list[select_partition].block_size & align_mask) != 0
+        || (pool_list[select_partition].bump->head == NULL
+            && pool_list[select_partition].bump->allocated >= pool_list[select_partition].bump->max
+            && !pool_grow(pool, &pool_list[select_partition])))) {
+        select_partition++;
+    }
+
+    if (select_partition >= pool->pool_count) {
+      //fprintf(stderr, "Err: No suitable memory pool found\n");
+      return NULL; // all partitions' blocks are too small or full to hold this data
+    }
+    pool_obj* curr_pool = &pool_list[select_partition];
+
+    // memory to be allocated
+    list_node* current = NULL;
+    bump_run* run = curr_pool->bump;
+
+    if (run->head == NULL) {
+      // get position of block to be allocated
+      current = (void *)(run->start + (run->allocated * curr_pool->block_size));
+      run->allocated++;
+      if (zeroed != NULL) {
+        *zeroed = run->zeroed;
+      }
+    }
+    else {
+      current = run->head; // first free block is allocated
+      run->head = run->head->next; // list is updated to remove allocated block
+      if (zeroed != NULL) {
+        *zeroed = false;
+      }
+    }
+    run->live++;
+    if (actual != NULL) {
+      *actual = curr_pool->block_size;
+    }
+
+    return current; // pointer to memory allocated
+#endif
+}
+
+/*
+ * This function is passed an instance and an unsigned value corresponding
+ * to the desired memory size to be allocated. Algorithm follows a best-fit
+ * approach, the smallest block size that can meet the needs of the user is
+ * allocated to the request. If all blocks are full and the pool cannot grow,
+ * the memory is allocated from the next largest pool.
+ *
+ * O(1) operation when the best-fit pool has a free block
+ *
+ * Returns: Pointer to allocated memory if successful, NULL if failed
+ */
+void* pool_malloc_in(pool_t* pool, size_t n)
+{
+
+    if ((int64_t)n <= 0) {
+      //fprintf(stderr, "Err: Cannot allocate non-positive value\n");
+      return NULL; // failure case - cannot allocate negative value
+    }
+
+    // determine which pool to allocate from, spilling into larger pools when full
+    void* block = pool_take(pool, size_to_pool(pool, n), 0, NULL, NULL);
+    trace_alloc(block, n);
+    return block;
+}
+
+/*
+ * This function allocates n bytes from the default instance.
+ * Returns: Pointer to allocated memory if successful, NULL if failed
+ */
+void* pool_malloc(size_t n)
+{
+    return pool_malloc_in(&g_default_pool, n);
+}
+
+/*
+ * This function allocates n bytes from an instance like pool_malloc_in and
+ * reports the size of the block handed out, all of which the caller may use.
+ * Returns: Pointer to allocated memory if successful, NULL if failed in
+ * which case actual is set to 0
+ */
+void* pool_malloc_sized_in(pool_t* pool, size_t n, size_t* actual)
+{
+    size_t block_size = 0;
+    void* block = NULL;
+
+    if ((int64_t)n > 0) {
+        block = pool_take(pool, size_to_pool(pool, n), 0, NULL, &block_size);
+        trace_alloc(block, n);
+    }
+    if (actual != NULL) {
+        *actual = block != NULL ? block_size : 0;
+    }
+    return block;
+}
+
+/*
+ * This function allocates n bytes from the default instance and reports
+ * the size of the block handed out.
+ * Returns: Pointer to allocated memory if successful, NULL if failed
+ */
+void* pool_malloc_sized(size_t n, size_t* actual)
+{
+    return pool_malloc_sized_in(&g_default_pool, n, actual);
+}
+
+/*
+ * This function allocates zeroed memory for count objects of size bytes
+ * from an instance. Blocks that were never handed out come from freshly
+ * mapped memory and are already zero, only recycled blocks are cleared,
+ * and only the bytes requested.
+ * Returns: Pointer to allocated memory if successful, NULL if failed or
+ * count * size overflows
+ */
+void* pool_calloc_in(pool_t* pool, size_t count, size_t size)
+{
+    size_t n;
+    if (!checked_mul(count, size, &n) || (int64_t)n <= 0) {
+      return NULL;
+    }
+
+    bool zeroed = false;
+    void* block = pool_take(pool, size_to_pool(pool, n), 0, &zeroed, NULL);
+    if (block != NULL && !zeroed) {
+        memset(block, 0, n);
+    }
+    trace_alloc(block, n);
+    return block;
+}
+
+/*
+ * This function allocates zeroed memory for count objects of size bytes
+ * from the default instance.
+ * Returns: Pointer to allocated memory if successful, NULL if failed
+ */
+void* pool_calloc(size_t count, size_t size)
+{
+    return pool_calloc_in(&g_default_pool, count, size);
+}
+
+/*
+ * This function allocates n bytes of an instance at an address that is a
+ * multiple of alignment. Partitions, chunks and slabs all start on a page
+ * boundary, so every block of a pool whose block size is a multiple of
+ * alignment is aligned. The best fit among those pools is used, spilling
+ * into larger ones the same way as pool_malloc_in.
+ * Returns: Pointer to allocated memory if successful, NULL if alignment is
+ * not a power of two, exceeds a page, or no pool has an aligned stride
+ */
+void* pool_aligned_alloc_in(pool_t* pool, size_t alignment, size_t n)
+{
+    if ((int64_t)n <= 0 || alignment == 0 || (alignment & (alignment - 1)) != 0
+        || alignment > POOL_PAGE_SIZE) {
+      return NULL;
+    }
+
+    void* block = pool_take(pool, size_to_pool(pool, n), alignment - 1, NULL, NULL);
+    trace_alloc(block, n);
+    return block;
+}
+
+/*
+ * This function allocates n bytes of the default instance aligned to alignment.
+ * Returns: Pointer to allocated memory if successful, NULL if failed
+ */
+void* pool_aligned_alloc(size_t alignment, size_t n)
+{
+    return pool_aligned_alloc_in(&g_default_pool, alignment, n);
+}
+
+/*
+ * This function tells whether a pointer is the start of a block of a pool,
+ * given its offset from the start of the run it falls in.
+ * Returns: True - if the offset is a multiple of the block size, else - False
+ */
+static inline bool block_start(const pool_obj* curr_pool, size_t offset)
+{
+    return (offset & curr_pool->block_low_mask) == 0 && offset * curr_pool->block_inverse <= curr_pool->block_limit;
+}
+
+/*
+ * This function finds the run a block belongs to, and through its owner
+ * the pool. Partition blocks are looked up in the page map and chunk or
+ * slab blocks in the chunk table. A pointer into the middle of a block is
+ * rejected, with a message in POOL_DEBUG builds.
+ * Returns: Pointer to the owning run, NULL if ptr is not the start of a block of this instance
+ */
+static bump_run* ptr_to_run(const pool_t* pool, const void* ptr)
+{
+    bump_run* run = NULL;
+
+    uintptr_t offset = (uintptr_t)ptr - (uintptr_t)pool->heap;
+    if (offset < pool->heap_size) {
+        uint8_t partition = page_partition(pool, offset >> POOL_PAGE_SHIFT);
+        if (partition != NO_POOL && (const uint8_t*)ptr < pool->pool_list[partition].pool_end) {
+            run = (bump_run*)&pool->pool_list[partition].partition;
+        }
+    }
+    if (run == NULL) {
+        offset = (uintptr_t)ptr - (uintptr_t)pool->grow_base;
+        if ((offset >> pool->chunk_shift) < pool->grow_chunks) {
+            const chunk_entry* entry = &pool->chunk_table[offset >> pool->chunk_shift];
+            run = entry->owner != NULL ? entry->run : NULL;
+        }
+    }
+
+    // determine whether the ptr corresponds to the correct block_size for partition
+    if (run != NULL && !block_start(run->owner, (size_t)((const uint8_t*)ptr - run->start))) {
+#ifdef POOL_DEBUG
+      fprintf(stderr, "\tErr: Pointer is not the start of a block\n");
+#endif
+      return NULL;
+    }
+
+    return run;
+}
+
+/*
+ * This function reports how many bytes of a block of an instance the
+ * caller may use, the block size of its pool.
+ * Returns: Usable size of the block, 0 if ptr is NULL or not from this instance
+ */
+size_t pool_usable_size_in(const pool_t* pool, const void* ptr)
+{
+    if (ptr == NULL) {
+        return 0;
+    }
+
+    const bump_run* run = ptr_to_run(pool, ptr);
+    return run != NULL ? ((const pool_obj*)run->owner)->block_size : 0;
+}
+
+/*
+ * This function reports how many bytes of a block of the default instance the caller may use.
+ * Returns: Usable size of the block, 0 if ptr is NULL or not from the default instance
+ */
+size_t pool_usable_size(const void* ptr)
+{
+    return pool_usable_size_in(&g_default_pool, ptr);
+}
+
+/*
+ * This function returns a block to the run it belongs to.
+ * Returns: No return value.
+ */
+static void block_release(pool_t* pool, bump_run* run, void* ptr)
+{
+    list_node* ptr_free = (list_node*)ptr;
+
+    trace_free(ptr); // before another thread can be handed the block
+
+#ifdef POOL_THREAD_SAFE
+    cache_free(pool, run, ptr_free);
+#else
+    run_return(pool, run, ptr_free, ptr_free, 1); // freed memory becomes new head of the run's list
+#endif
+}
+
+/*
+ * This function deallocates memory blocks of an instance based on the ptr
+ * parameter. The parameter must be a pointer corresponding to a valid
+ * place in memory. The newly-freed memory is assigned to the head of the
+ * unused memory and will be used next when allocating new memory.
+ * Pointers that do not belong to the instance are ignored.
+ *
+ * O(1) operation
+ *
+ * Returns: No return value.
+ */
+void pool_free_in(pool_t* pool, void* ptr)
+{
+
+    if (ptr == NULL) {
+      fprintf(stderr, "\tErr: NULL pointer");
+      return; // no processing to be done
+    }
+
+    if (!pool_try_free_in(pool, ptr)) {
+      //fprintf(stderr, "\tErr: Pointer does not correspond to allocated memory\n");
+      return; // ptr not found - fail case
+    }
+}
+
+/*
+ * This function releases a block of an instance if ptr is one, finding
+ * its pool only once, so callers holding pointers from several allocators
+ * need no separate ownership check.
+ * Returns: True - if the block was released, else - False
+ */
+bool pool_try_free_in(pool_t* pool, void* ptr)
+{
+    bump_run* run = ptr != NULL ? ptr_to_run(pool, ptr) : NULL;
+    if (run == NULL) {
+      return false;
+    }
+
+    block_release(pool, run, ptr);
+    return true;
+}
+
+/*
+ * This function releases a block of the default instance if ptr is one.
+ * Returns: True - if the block was released, else - False
+ */
+bool pool_try_free(void* ptr)
+{
+    return pool_try_free_in(&g_default_pool, ptr);
+}
+
+/*
+ * This function releases a block allocated from the default instance.
+ * Returns: No return value.
+ */
+void pool_free(void* ptr)
+{
+    pool_free_in(&g_default_pool, ptr);
+}
+
+/*
+ * This function resizes a block of an instance to hold n bytes. A block
+ * that can already hold n bytes is kept as it is, else the contents are
+ * copied into a block of a fitting size class and the old block is freed.
+ * A NULL ptr allocates and a zero n frees.
+ * Returns: Pointer to the resized memory, NULL if it could not be resized
+ * in which case ptr is left untouched
+ */
+void* pool_realloc_in(pool_t* pool, void* ptr, size_t n)
+{
+    if (ptr == NULL) {
+        return pool_malloc_in(pool, n);
+    }
+    if (n == 0) {
+        pool_free_in(pool, ptr);
+        return NULL;
+    }
+
+    bump_run* run = ptr_to_run(pool, ptr);
+    if (run == NULL) {
+      return NULL; // ptr not found - fail case
+    }
+    pool_obj* curr_pool = run->owner;
+
+    // rounding up to the block size left room to grow in place, a replay
+    // sees the new size as the block being freed and allocated again
+    if (n <= curr_pool->block_size) {
+        trace_free(ptr);
+        trace_alloc(ptr, n);
+        return ptr;
+    }
+
+    void* moved = pool_malloc_in(pool, n);
+    if (moved == NULL) {
+        return NULL;
+    }
+    memcpy(moved, ptr, curr_pool->block_size);
+    block_release(pool, run, ptr);
+    return moved;
+}
+
+/*
+ * This function resizes a block of the default instance to hold n bytes.
+ * Returns: Pointer to the resized memory, NULL if it could not be resized
+ */
+void* pool_realloc(void* ptr, size_t n)
+{
+    return pool_realloc_in(&g_default_pool, ptr, n);
+}
+
+/*
+ * This function deallocates a block of an instance whose requested size n
+ * is known. The size class of n is resolved through the lookup table and
+ * a block inside that pool's partition is pushed without a page map
+ * lookup. Blocks from growth chunks or slabs, and blocks that spilled into
+ * a larger pool, fall back to the lookup pool_free_in performs. POOL_DEBUG
+ * builds always perform the lookup and report a size the block cannot hold.
+ * Returns: No return value.
+ */
+void pool_free_sized_in(pool_t* pool, void* ptr, size_t n)
+{
+    if (ptr == NULL) {
+      return; // no processing to be done
+    }
+
+#ifndef POOL_DEBUG
+    size_t pool_index = size_to_pool(pool, n);
+    if (pool_index < pool->pool_count) {
+        pool_obj* curr_pool = &pool->pool_list[pool_index];
+        if ((uint8_t*)ptr >= curr_pool->pool_start && (uint8_t*)ptr < curr_pool->pool_end
+            && block_start(curr_pool, (size_t)((uint8_t*)ptr - curr_pool->pool_start))) {
+            block_release(pool, &curr_pool->partition, ptr);
+            return;
+        }
+    }
+#endif
+
+    bump_run* run = ptr_to_run(pool, ptr);
+    if (run == NULL) {
+      return; // ptr not found - fail case
+    }
+
+#ifdef POOL_DEBUG
+    if (n > ((pool_obj*)run->owner)->block_size) {
+      fprintf(stderr, "\tErr: Size is larger than the block\n");
+      return;
+    }
+#endif
+
+    block_release(pool, run, ptr);
+}
+
+/*
+ * This function deallocates a block of the default instance whose requested size is known.
+ * Returns: No return value.
+ */
+void pool_free_sized(void* ptr, size_t n)
+{
+    pool_free_sized_in(&g_default_pool, ptr, n);
+}
+
+/*
+ * This function resolves the pool of an instance that holds n bytes at
+ * alignment, the best fit among pools whose block size is a multiple of
+ * alignment. Callers allocating one type over and over resolve it once
+ * and pass it to pool_malloc_class_in and pool_free_class_in.
+ * Returns: Index of the pool, POOL_NO_CLASS if alignment is not a power of
+ * two up to a page or no block size is big enough
+ */
+size_t pool_size_class_in(const pool_t* pool, size_t n, size_t alignment)
+{
+    if ((int64_t)n <= 0 || alignment == 0 || (alignment & (alignment - 1)) != 0
+        || alignment > POOL_PAGE_SIZE) {
+      return POOL_NO_CLASS;
+    }
+
+    size_t pool_index = size_to_pool(pool, n);
+    while (pool_index < pool->pool_count && (pool->pool_list[pool_index].block_size & (alignment - 1)) != 0) {
+        pool_index++;
+    }
+    return pool_index < pool->pool_count ? pool_index : POOL_NO_CLASS;
+}
+
+/*
+ * This function resolves the pool of the default instance that holds n bytes at alignment.
+ * Returns: Index of the pool, POOL_NO_CLASS if none can hold it
+ */
+size_t pool_size_class(size_t n, size_t alignment)
+{
+    return pool_size_class_in(&g_default_pool, n, alignment);
+}
+
+/*
+ * This function allocates a block from a pool resolved by
+ * pool_size_class_in, skipping the size class lookup. A full pool spills
+ * only into larger pools whose blocks keep the alignment of its own.
+ * Returns: Pointer to allocated memory if successful, NULL if failed
+ */
+void* pool_malloc_class_in(pool_t* pool, size_t size_class)
+{
+    if (size_class >= pool->pool_count) {
+      return NULL;
+    }
+
+    // lowest set bit of the block size is the alignment every block has
+    size_t block_size = pool->pool_list[size_class].block_size;
+    size_t align_mask = (block_size & (0 - block_size)) - 1;
+    if (align_mask >= POOL_PAGE_SIZE) {
+        align_mask = POOL_PAGE_SIZE - 1;
+    }
+
+    void* block = pool_take(pool, size_class, align_mask, NULL, NULL);
+    trace_alloc(block, block_size);
+    return block;
+}
+
+/*
+ * This function allocates a block from a pool of the default instance resolved by pool_size_class.
+ * Returns: Pointer to allocated memory if successful, NULL if failed
+ */
+void* pool_malloc_class(size_t size_class)
+{
+    return pool_malloc_class_in(&g_default_pool, size_class);
+}
+
+/*
+ * This function deallocates a block of an instance allocated from
+ * size_class. A block inside that pool's partition is pushed without a
+ * page map lookup, blocks from growth chunks or slabs, and blocks that
+ * spilled into a larger pool, fall back to the lookup pool_free_in
+ * performs. POOL_DEBUG builds always perform the lookup.
+ * Returns: No return value.
+ */
+void pool_free_class_in(pool_t* pool, size_t size_class, void* ptr)
+{
+    if (ptr == NULL) {
+      return; // no processing to be done
+    }
+
+#ifndef POOL_DEBUG
+    if (size_class < pool->pool_count) {
+        pool_obj* curr_pool = &pool->pool_list[size_class];
+        if ((uint8_t*)ptr >= curr_pool->pool_start && (uint8_t*)ptr < curr_pool->pool_end
+            && block_start(curr_pool, (size_t)((uint8_t*)ptr - curr_pool->pool_start))) {
+            block_release(pool, &curr_pool->partition, ptr);
+            return;
+        }
+    }
+#else
+    (void)size_class;
+#endif
+
+    pool_free_in(pool, ptr);
+}
+
+/*
+ * This function deallocates a block of the default instance allocated from size_class.
+ * Returns: No return value.
+ */
+void pool_free_class(size_t size_class, void* ptr)
+{
+    pool_free_class_in(&g_default_pool, size_class, ptr);
+}
+
+/*
+ * This function allocates count blocks of n bytes each from an instance,
+ * resolving the size class once. Recycled blocks are unlinked from the
+ * free list in one pass and never-used blocks are taken from the bump
+ * run in one step. Requests the pool cannot satisfy spill into larger
+ * pools the same way as pool_malloc_in.
+ * Returns: Number of blocks written to out, fewer than count if memory ran out
+ */
+size_t pool_malloc_bulk_in(pool_t* pool, size_t n, void** out, size_t count)
+{
+    if ((int64_t)n <= 0 || out == NULL) {
+      return 0; // failure case - cannot allocate negative value
+    }
+
+    size_t select_partition = size_to_pool(pool, n);
+
+#ifdef POOL_THREAD_SAFE
+    size_t done = cache_malloc_bulk(pool, select_partition, out, count);
+#else
+    size_t done = 0;
+
+    while (done < count && select_partition < pool->pool_count) {
+        pool_obj* curr_pool = &pool->pool_list[select_partition];
+        bump_run* run = curr_pool->bump;
+        size_t popped = done;
+
+        while (done < count && run->head != NULL) {
+            out[done++] = run->head;
+            run->head = run->head->next;
+        }
+
+        size_t take = run->max - run->allocated;
+        if (take > count - done) {
+            take = count - done;
+        }
+        uint8_t* block = run->start + (run->allocated * curr_pool->block_size);
+        run->allocated += take;
+        for (size_t i = 0; i < take; ++i) {
+            out[done++] = block + (i * curr_pool->block_size);
+        }
+        run->live += done - popped;
+
+        if (done < count && !pool_grow(pool, curr_pool)) {
+            select_partition++;
+        }
+    }
+#endif
+
+    for (size_t i = 0; i < done; ++i) {
+        trace_alloc(out[i], n);
+    }
+    return done;
+}
+
+/*
+ * This function allocates count blocks of n bytes each from the default instance.
+ * Returns: Number of blocks written to out, fewer than count if memory ran out
+ */
+size_t pool_malloc_bulk(size_t n, void** out, size_t count)
+{
+    return pool_malloc_bulk_in(&g_default_pool, n, out, count);
+}
+
+/*
+ * This function releases count blocks of an instance. Consecutive blocks
+ * of the same run are linked into one segment and pushed with a single
+ * head update. NULL and foreign pointers are skipped.
+ * Returns: No return value.
+ */
+void pool_free_bulk_in(pool_t* pool, void** ptrs, size_t count)
+{
+    bump_run* run = count > 0 ? ptr_to_run(pool, ptrs[0]) : NULL;
+    size_t i = 0;
+
+    while (i < count) {
+        list_node* first = ptrs[i];
+        list_node* last = first;
+        size_t segment = 1;
+        bump_run* next_run = NULL;
+
+        if (run != NULL) {
+            trace_free(first);
+        }
+        for (++i; i < count; ++i) {
+            next_run = ptr_to_run(pool, ptrs[i]);
+            if (next_run != run) {
+                break;
+            }
+            if (run != NULL) {
+                trace_free(ptrs[i]);
+                NEXT_STORE(last, ptrs[i]);
+                last = ptrs[i];
+                segment++;
+            }
+        }
+
+        if (run != NULL) {
+#ifdef POOL_THREAD_SAFE
+            cache_free_bulk(pool, run, first, last, segment);
+#else
+            run_return(pool, run, first, last, segment);
+#endif
+        }
+        run = next_run;
+    }
+}
+
+/*
+ * This function releases count blocks allocated from the default instance.
+ * Returns: No return value.
+ */
+void pool_free_bulk(void** ptrs, size_t count)
+{
+    pool_free_bulk_in(&g_default_pool, ptrs, count);
 }
@@ -1,3 +1,61 @@
+#ifndef POOL_ALLOC_H
+#define POOL_ALLOC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef POOL_STATIC_CONFIG
+// POOL_STATIC_CONFIG names a header defining POOL_STATIC_POOLS(X) as one
+// X(block_size, block_count) per pool, ascending by block size, e.g.
+// `#define POOL_STATIC_POOLS(X) X(32, 1024) X(64, 512) X(256, 128)`. The
+// default instance is then laid out at compile time and pool_init fails.
+#include POOL_STATIC_CONFIG
+
+#define POOL_STATIC_ONE_(size, count) + 1
+#define POOL_STATIC_MISFIT_(size, count) \
+    (n > (size) || ((size) & (alignment - 1)) != 0 || (alignment & (alignment - 1)) != 0 || alignment > 256) * (1 +
+#define POOL_STATIC_CLOSE_(size, count) )
+
+// Number of pools of the default instance.
+#define POOL_STATIC_COUNT (0 POOL_STATIC_POOLS(POOL_STATIC_ONE_))
+
+// Size class of the default instance that holds n bytes at alignment, a
+// power of two up to 256. The pools before the first that fits are counted
+// by a product chain, one comparison per pool and no branches, folded to a
+// constant when n and alignment are.
+// Returns the size class, POOL_STATIC_COUNT if no pool can hold the request.
+#ifdef __cplusplus
+constexpr
+#else
+static inline
+#endif
+size_t pool_static_class(size_t n, size_t alignment)
+{
+    return POOL_STATIC_POOLS(POOL_STATIC_MISFIT_) 0 POOL_STATIC_POOLS(POOL_STATIC_CLOSE_);
+}
+#endif
+
+// Allocator instance with its own heap and pools, created by pool_create.
+typedef struct pool_t pool_t;
+
+// Parameters used to lay out an allocator instance.
+typedef struct {
+    const size_t* block_sizes;   // block size of each pool
+    size_t block_size_count;     // number of entries in block_sizes
+    const size_t* block_weights; // relative share of the heap per block size, or NULL
+    const size_t* block_counts;  // blocks reserved per block size, or NULL for equal shares
+    void* heap;                  // caller-owned memory for the pools, NULL to map one
+    size_t heap_size;            // size of heap in bytes, 0 for the 64 KiB default
+    size_t chunk_size;           // bytes a full pool maps to grow, 0 disables growth
+    size_t grow_limit;           // most bytes mapped for growth, 0 for 1 GiB
+    size_t slab_size;            // bytes per slab pools take from a shared heap, 0 for fixed partitions
+} pool_config;
+
 // Initialize the pool allocator with a set of block sizes appropriate for this application.
 
 // Returns true on success, false on failure.
@@ -9,3 +67,151 @@ void* pool_malloc(size_t n);
 
 // Release allocation pointed to by ptr.
 void pool_free(void* ptr);
+
+// Initialize the pool allocator from a full configuration, including its heap.
+// Returns true on success, false on failure.
+bool pool_init_config(const pool_config* config);
+
+// Create an allocator instance independent of the one used by pool_init.
+// Returns pointer to the instance on success, NULL on failure.
+pool_t* pool_create(const pool_config* config);
+
+// Destroy an instance created by pool_create, releasing all of its memory.
+void pool_destroy(pool_t* pool);
+
+// Take every lock of pool, so a fork cannot copy one held mid-operation into the child.
+void pool_lock_all(pool_t* pool);
+
+// Release the locks taken by pool_lock_all, resetting them instead when child is set.
+void pool_unlock_all(pool_t* pool, bool child);
+
+// Allocate n bytes from pool.
+// Returns pointer to allocate memory on success, NULL on failure.
+void* pool_malloc_in(pool_t* pool, size_t n);
+
+// Release allocation pointed to by ptr back to pool.
+void pool_free_in(pool_t* pool, void* ptr);
+
+// Release allocation pointed to by ptr if it is one, leaving any other pointer alone.
+// Returns true if ptr was released, false if it was not allocated by pool_malloc.
+bool pool_try_free(void* ptr);
+
+// Release allocation pointed to by ptr in pool if it is one, leaving any other pointer alone.
+// Returns true if ptr was released, false if it does not belong to pool.
+bool pool_try_free_in(pool_t* pool, void* ptr);
+
+// Allocate n bytes, writing the size of the block handed out to actual.
+// Returns pointer to allocate memory on success, NULL on failure.
+void* pool_malloc_sized(size_t n, size_t* actual);
+
+// Allocate n bytes from pool, writing the size of the block handed out to actual.
+// Returns pointer to allocate memory on success, NULL on failure.
+void* pool_malloc_sized_in(pool_t* pool, size_t n, size_t* actual);
+
+// Returns the number of bytes usable in the allocation pointed to by ptr, 0 if it is not one.
+size_t pool_usable_size(const void* ptr);
+
+// Returns the number of bytes usable in the allocation pointed to by ptr in pool, 0 if it is not one.
+size_t pool_usable_size_in(const pool_t* pool, const void* ptr);
+
+// Allocate zeroed memory for count objects of size bytes.
+// Returns pointer to allocate memory on success, NULL on failure.
+void* pool_calloc(size_t count, size_t size);
+
+// Allocate zeroed memory for count objects of size bytes from pool.
+// Returns pointer to allocate memory on success, NULL on failure.
+void* pool_calloc_in(pool_t* pool, size_t count, size_t size);
+
+// Allocate n bytes at an address that is a multiple of alignment, a power of two up to 256.
+// Returns pointer to allocate memory on success, NULL on failure.
+void* pool_aligned_alloc(size_t alignment, size_t n);
+
+// Allocate n bytes from pool at an address that is a multiple of alignment.
+// Returns pointer to allocate memory on success, NULL on failure.
+void* pool_aligned_alloc_in(pool_t* pool, size_t alignment, size_t n);
+
+// Resize allocation pointed to by ptr to n bytes, moving it only if its block is too small.
+// Returns pointer to the resized memory on success, NULL on failure with ptr left valid.
+void* pool_realloc(void* ptr, size_t n);
+
+// Resize allocation pointed to by ptr in pool to n bytes.
+// Returns pointer to the resized memory on success, NULL on failure with ptr left valid.
+void* pool_realloc_in(pool_t* pool, void* ptr, size_t n);
+
+// Release allocation pointed to by ptr, which was requested with n bytes.
+void pool_free_sized(void* ptr, size_t n);
+
+// Release allocation pointed to by ptr, which was requested with n bytes, back to pool.
+void pool_free_sized_in(pool_t* pool, void* ptr, size_t n);
+
+// Size class returned when no pool can hold a request.
+#define POOL_NO_CLASS SIZE_MAX
+
+// Resolve once the pool that holds n bytes at alignment, for pool_malloc_class and pool_free_class.
+// Returns the size class on success, POOL_NO_CLASS on failure.
+size_t pool_size_class(size_t n, size_t alignment);
+
+// Resolve once the pool of pool that holds n bytes at alignment.
+// Returns the size class on success, POOL_NO_CLASS on failure.
+size_t pool_size_class_in(const pool_t* pool, size_t n, size_t alignment);
+
+// Allocate a block of a size class resolved by pool_size_class.
+// Returns pointer to allocate memory on success, NULL on failure.
+void* pool_malloc_class(size_t size_class);
+
+// Allocate a block of a size class of pool resolved by pool_size_class_in.
+// Returns pointer to allocate memory on success, NULL on failure.
+void* pool_malloc_class_in(pool_t* pool, size_t size_class);
+
+// Release allocation pointed to by ptr, which was allocated from size_class.
+void pool_free_class(size_t size_class, void* ptr);
+
+// Release allocation pointed to by ptr, which was allocated from size_class, back to pool.
+void pool_free_class_in(pool_t* pool, size_t size_class, void* ptr);
+
+// Allocate count blocks of n bytes each, writing them to out.
+// Returns the number of blocks allocated, fewer than count if memory ran out.
+size_t pool_malloc_bulk(size_t n, void** out, size_t count);
+
+// Release count allocations pointed to by ptrs.
+void pool_free_bulk(void** ptrs, size_t count);
+
+// Allocate count blocks of n bytes each from pool, writing them to out.
+// Returns the number of blocks allocated, fewer than count if memory ran out.
+size_t pool_malloc_bulk_in(pool_t* pool, size_t n, void** out, size_t count);
+
+// Release count allocations pointed to by ptrs back to pool.
+void pool_free_bulk_in(pool_t* pool, void** ptrs, size_t count);
+
+// Trace files start with a pool_trace_header followed by pool_trace_event records.
+#define POOL_TRACE_MAGIC 0x43525450u // "PTRC" read as a little-endian uint32_t
+#define POOL_TRACE_VERSION 1
+#define POOL_TRACE_MALLOC 0
+#define POOL_TRACE_FREE 1
+
+typedef struct {
+    uint32_t magic;              // POOL_TRACE_MAGIC
+    uint32_t version;            // POOL_TRACE_VERSION
+} pool_trace_header;
+
+typedef struct {
+    uint64_t time;               // nanoseconds since recording started
+    uint64_t size;               // bytes requested, 0 for frees
+    uint32_t id;                 // allocation the event belongs to, numbered from 1
+    uint8_t op;                  // POOL_TRACE_MALLOC or POOL_TRACE_FREE
+    uint8_t reserved[3];
+} pool_trace_event;
+
+// Record every allocation and free to the file at path, needs a build with -DPOOL_TRACE.
+// A block resized in place by realloc is recorded as freed and allocated again.
+// Returns true on success, false on failure.
+bool pool_trace_start(const char* path);
+
+// Stop recording and close the trace file.
+void pool_trace_stop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // POOL_ALLOC_H
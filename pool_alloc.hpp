@@ -0,0 +1,97 @@
+#ifndef POOL_ALLOC_HPP
+#define POOL_ALLOC_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include "pool_alloc.h"
+
+/*
+ * Standard allocator over a pool instance, so node-based containers
+ * (std::list, std::map, std::unordered_map) take their nodes from fixed-size
+ * pools. The allocator holds a pool_t handle, a default-constructed one
+ * uses the instance set up by pool_init. Blocks are requested at the
+ * alignment of T and returned with their size, so freeing a node skips the
+ * page map lookup whenever the node landed in the pool of its size class.
+ * Arrays such as the buckets of std::unordered_map come from the same
+ * instance, so it needs a block size that holds the largest of them.
+ */
+
+template <class T>
+class PoolAllocator {
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+    using is_always_equal = std::false_type;
+
+    template <class U>
+    struct rebind {
+        using other = PoolAllocator<U>;
+    };
+
+    PoolAllocator() noexcept : pool_(nullptr) {}
+    explicit PoolAllocator(pool_t* pool) noexcept : pool_(pool) {}
+
+    template <class U>
+    PoolAllocator(const PoolAllocator<U>& other) noexcept : pool_(other.pool()) {}
+
+    /*
+     * This function allocates room for n objects of type T. A zero n still
+     * gets a block of its own, as it does from pool_memory_resource.
+     * Returns: Pointer to the storage, throws std::bad_alloc if no pool can hold it
+     */
+    T* allocate(size_type n)
+    {
+        if (n > SIZE_MAX / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+
+        size_type bytes = n != 0 ? n * sizeof(T) : 1;
+        void* ptr = pool_ != nullptr ? pool_aligned_alloc_in(pool_, alignof(T), bytes)
+                                     : pool_aligned_alloc(alignof(T), bytes);
+        if (ptr == nullptr) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(ptr);
+    }
+
+    /*
+     * This function returns the storage of n objects obtained from allocate.
+     * Returns: No return value.
+     */
+    void deallocate(T* ptr, size_type n) noexcept
+    {
+        if (pool_ != nullptr) {
+            pool_free_sized_in(pool_, ptr, n * sizeof(T));
+        }
+        else {
+            pool_free_sized(ptr, n * sizeof(T));
+        }
+    }
+
+    // instance blocks come from, NULL for the pool_init instance
+    pool_t* pool() const noexcept { return pool_; }
+
+private:
+    pool_t* pool_;
+};
+
+// allocators compare equal when either can free what the other allocated
+template <class T, class U>
+bool operator==(const PoolAllocator<T>& a, const PoolAllocator<U>& b) noexcept
+{
+    return a.pool() == b.pool();
+}
+
+template <class T, class U>
+bool operator!=(const PoolAllocator<T>& a, const PoolAllocator<U>& b) noexcept
+{
+    return a.pool() != b.pool();
+}
+
+#endif // POOL_ALLOC_HPP
@@ -0,0 +1,104 @@
+#ifndef POOL_OBJECT_HPP
+#define POOL_OBJECT_HPP
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include "pool_alloc.h"
+
+/*
+ * Typed object pool for hot types. The request is fixed at compile time
+ * from sizeof(T) and alignof(T), so create costs a single free-list pop
+ * and destroy a single push, with neither the size class search of
+ * pool_malloc nor the page map lookup of pool_free. With POOL_STATIC_CONFIG
+ * a default-constructed pool_object uses the size class of the compile-time
+ * layout, a constant, and works before main. Otherwise the pool is resolved
+ * once when the pool_object is constructed, so a default-constructed one
+ * uses the pool_init instance and must be created after it.
+ */
+
+template <class T>
+class pool_object {
+public:
+    static constexpr std::size_t size = sizeof(T);
+    static constexpr std::size_t alignment = alignof(T);
+    static_assert(alignment <= 256, "pool blocks are aligned to at most 256 bytes");
+
+#ifdef POOL_STATIC_CONFIG
+    // size class of a T in the compile-time layout of the default instance
+    static constexpr std::size_t static_class = pool_static_class(size, alignment);
+
+    pool_object() noexcept : pool_(nullptr), size_class_(static_class)
+    {
+        static_assert(static_class != POOL_STATIC_COUNT, "no pool of POOL_STATIC_POOLS can hold a T");
+    }
+#else
+    pool_object() noexcept : pool_(nullptr), size_class_(pool_size_class(size, alignment)) {}
+#endif
+    explicit pool_object(pool_t* pool) noexcept : pool_(pool), size_class_(pool_size_class_in(pool, size, alignment)) {}
+
+    /*
+     * This function constructs a T from args in a block of the bound pool.
+     * Returns: Pointer to the object, throws std::bad_alloc if no block is free
+     */
+    template <class... Args>
+    T* create(Args&&... args)
+    {
+        void* block = pool_ != nullptr ? pool_malloc_class_in(pool_, size_class_) : pool_malloc_class(default_class());
+        if (block == nullptr) {
+            throw std::bad_alloc();
+        }
+
+        try {
+            return ::new (block) T(std::forward<Args>(args)...);
+        }
+        catch (...) {
+            release(block);
+            throw;
+        }
+    }
+
+    /*
+     * This function destroys an object made by create and returns its block.
+     * Returns: No return value.
+     */
+    void destroy(T* ptr) noexcept
+    {
+        if (ptr != nullptr) {
+            ptr->~T();
+            release(ptr);
+        }
+    }
+
+    // instance objects come from, NULL for the pool_init instance
+    pool_t* pool() const noexcept { return pool_; }
+
+    // pool bound at construction, POOL_NO_CLASS if none can hold a T
+    std::size_t size_class() const noexcept { return size_class_; }
+
+private:
+    // size class in the default instance, a constant in POOL_STATIC_CONFIG builds
+    std::size_t default_class() const noexcept
+    {
+#ifdef POOL_STATIC_CONFIG
+        return static_class;
+#else
+        return size_class_;
+#endif
+    }
+
+    void release(void* block) noexcept
+    {
+        if (pool_ != nullptr) {
+            pool_free_class_in(pool_, size_class_, block);
+        }
+        else {
+            pool_free_class(default_class(), block);
+        }
+    }
+
+    pool_t* pool_;
+    std::size_t size_class_;
+};
+
+#endif // POOL_OBJECT_HPP
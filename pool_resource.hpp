@@ -0,0 +1,71 @@
+#ifndef POOL_RESOURCE_HPP
+#define POOL_RESOURCE_HPP
+
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+#include "pool_alloc.h"
+
+/*
+ * Polymorphic memory resource over a pool instance, so std::pmr containers
+ * of one request or subsystem draw from their own pools. Every allocation
+ * is served at the size and alignment the pmr API passes in. Requests no
+ * pool can hold, larger than the largest block size, aligned beyond a pool
+ * page, or arriving when a fixed instance is full, are passed to the
+ * upstream resource, which by default throws std::bad_alloc. Deallocation
+ * tells the two apart by the instance's address ranges.
+ */
+
+class pool_memory_resource : public std::pmr::memory_resource {
+public:
+    explicit pool_memory_resource(pool_t* pool,
+                                  std::pmr::memory_resource* upstream = std::pmr::null_memory_resource()) noexcept
+        : pool_(pool), upstream_(upstream) {}
+
+    pool_memory_resource(const pool_memory_resource&) = delete;
+    pool_memory_resource& operator=(const pool_memory_resource&) = delete;
+
+    // instance blocks come from
+    pool_t* pool() const noexcept { return pool_; }
+
+    // resource taking what the instance cannot hold
+    std::pmr::memory_resource* upstream_resource() const noexcept { return upstream_; }
+
+protected:
+    /*
+     * This function allocates bytes aligned to alignment from the instance,
+     * or from the upstream resource when no pool can hold the request.
+     * Returns: Pointer to the storage, throws std::bad_alloc if neither can
+     */
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        void* ptr = pool_aligned_alloc_in(pool_, alignment, bytes != 0 ? bytes : 1);
+        return ptr != nullptr ? ptr : upstream_->allocate(bytes, alignment);
+    }
+
+    /*
+     * This function returns storage to the instance, or to the upstream
+     * resource if the instance does not own it.
+     * Returns: No return value.
+     */
+    void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override
+    {
+        // one ownership lookup, which also releases the block when it succeeds
+        if (!pool_try_free_in(pool_, ptr)) {
+            upstream_->deallocate(ptr, bytes, alignment);
+        }
+    }
+
+    // resources are interchangeable when they share an instance and upstream
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        const pool_memory_resource* resource = dynamic_cast<const pool_memory_resource*>(&other);
+        return resource != nullptr && resource->pool_ == pool_ && *resource->upstream_ == *upstream_;
+    }
+
+private:
+    pool_t* pool_;
+    std::pmr::memory_resource* upstream_;
+};
+
+#endif // POOL_RESOURCE_HPP
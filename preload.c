@@ -0,0 +1,394 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "pool_alloc.h"
+
+/*
+* Drop-in replacement for the C allocation functions, so unmodified
+* programs run on the pool allocator through LD_PRELOAD. Requests up to the
+* largest size class are served by one growing pool instance, larger ones
+* and stricter alignments get their own anonymous mapping, recorded in a
+* table so free can tell them apart from any other pointer. Pointers that
+* belong to neither are ignored instead of corrupting either allocator.
+*
+* The instance itself allocates a few objects (its descriptor, page map and
+* per-thread caches). Those calls arrive here while a call is already in
+* progress on the same thread and are served by mappings, so the
+* allocator never recurses into itself. Fork handlers hold every allocator
+* lock across fork, so a child never inherits one taken by another thread.
+*
+* Build with
+* `gcc -O2 -shared -fPIC -DPOOL_THREAD_SAFE -pthread preload.c pool_alloc.c -o libpoolalloc.so`
+* and run `LD_PRELOAD=./libpoolalloc.so program`.
+*/
+
+#ifndef POOL_THREAD_SAFE
+#error "preload.c replaces malloc for any program, build with -DPOOL_THREAD_SAFE -pthread"
+#endif
+
+#define SHIM_PAGE 4096                  // mappings are made in whole OS pages
+#define SHIM_CHUNK 65536                // growth chunk of the pool instance
+#define SHIM_GROW_LIMIT ((size_t)16 << 30) // address space reserved for growth
+#define SHIM_ALIGNMENT 256              // strictest alignment a size class can give
+
+#define SHIM_EXPORT __attribute__((visibility("default")))
+
+// size classes, finer steps for small sizes where most requests fall
+static const size_t g_shim_sizes[] = {
+    16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 448, 512,
+    640, 768, 896, 1024, 1280, 1536, 1792, 2048, 2560, 3072, 3584, 4096, 8192, 16384, 32768
+};
+#define SHIM_CLASSES (sizeof(g_shim_sizes) / sizeof(g_shim_sizes[0]))
+#define SHIM_LARGEST 32768
+
+// one mapping handed out by map_alloc
+typedef struct {
+    void* ptr;              // address returned to the caller, NULL for an empty slot
+    size_t length;          // bytes mapped from ptr
+} mapping;
+
+static pool_t* g_shim_pool;            // instance small requests are served from
+static pthread_once_t g_shim_once = PTHREAD_ONCE_INIT;
+static __thread int t_shim_depth __attribute__((tls_model("initial-exec"))); // nested calls on this thread
+
+static mapping* g_mappings;            // open-addressed table of live mappings
+static size_t g_mapping_capacity;      // slots in g_mappings, a power of two
+static size_t g_mapping_count;         // live mappings in g_mappings
+static pthread_mutex_t g_mapping_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * This function finds the slot of a mapping, or the empty slot it belongs in.
+ * Returns: Index of the slot
+ */
+static size_t mapping_find(const void* ptr)
+{
+    size_t mask = g_mapping_capacity - 1;
+    size_t i = ((uintptr_t)ptr >> 12) * 0x9E3779B97F4A7C15u >> 20 & mask;
+    while (g_mappings[i].ptr != NULL && g_mappings[i].ptr != ptr) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+/*
+ * This function records a mapping, doubling the table when it is half full.
+ * The table lives in its own mappings so it never calls malloc.
+ * Returns: True - if the mapping was recorded, else - False
+ */
+static bool mapping_add(void* ptr, size_t length)
+{
+    bool added = false;
+
+    pthread_mutex_lock(&g_mapping_lock);
+    if ((g_mapping_count + 1) * 2 > g_mapping_capacity) {
+        size_t capacity = g_mapping_capacity != 0 ? g_mapping_capacity * 2 : SHIM_PAGE / sizeof(mapping);
+        mapping* slots = mmap(NULL, capacity * sizeof(mapping), PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (slots == MAP_FAILED) {
+            pthread_mutex_unlock(&g_mapping_lock);
+            return false;
+        }
+
+        mapping* old = g_mappings;
+        size_t old_capacity = g_mapping_capacity;
+        g_mappings = slots;
+        g_mapping_capacity = capacity;
+        for (size_t i = 0; i < old_capacity; ++i) {
+            if (old[i].ptr != NULL) {
+                g_mappings[mapping_find(old[i].ptr)] = old[i];
+            }
+        }
+        if (old != NULL) {
+            munmap(old, old_capacity * sizeof(mapping));
+        }
+    }
+
+    size_t slot = mapping_find(ptr);
+    if (g_mappings[slot].ptr == NULL) {
+        g_mappings[slot] = (mapping){ptr, length};
+        g_mapping_count++;
+        added = true;
+    }
+    pthread_mutex_unlock(&g_mapping_lock);
+    return added;
+}
+
+/*
+ * This function looks up a mapping and, if remove is set, forgets it.
+ * Returns: Bytes mapped at ptr, 0 if ptr is not a mapping
+ */
+static size_t mapping_lookup(const void* ptr, bool remove)
+{
+    size_t length = 0;
+
+    pthread_mutex_lock(&g_mapping_lock);
+    if (g_mapping_capacity != 0) {
+        size_t hole = mapping_find(ptr);
+        length = g_mappings[hole].length;
+        if (g_mappings[hole].ptr != NULL && remove) {
+            // backward-shift deletion keeps every probe sequence unbroken
+            size_t mask = g_mapping_capacity - 1;
+            size_t i = hole;
+            for (;;) {
+                i = (i + 1) & mask;
+                if (g_mappings[i].ptr == NULL) {
+                    break;
+                }
+                size_t home = ((uintptr_t)g_mappings[i].ptr >> 12) * 0x9E3779B97F4A7C15u >> 20 & mask;
+                if (((i - home) & mask) >= ((i - hole) & mask)) {
+                    g_mappings[hole] = g_mappings[i];
+                    hole = i;
+                }
+            }
+            g_mappings[hole] = (mapping){NULL, 0};
+            g_mapping_count--;
+        }
+        else if (g_mappings[hole].ptr == NULL) {
+            length = 0;
+        }
+    }
+    pthread_mutex_unlock(&g_mapping_lock);
+    return length;
+}
+
+/*
+ * This function maps n bytes at a multiple of alignment, trimming the
+ * excess of an over-sized mapping when the alignment exceeds a page.
+ * Returns: Pointer to zeroed memory, NULL if it could not be mapped
+ */
+static void* map_alloc(size_t n, size_t alignment)
+{
+    size_t length = (n + SHIM_PAGE - 1) & ~(size_t)(SHIM_PAGE - 1);
+    size_t extra = alignment > SHIM_PAGE ? alignment : 0;
+    if (length < n || length + extra < length) {
+        return NULL;
+    }
+
+    uint8_t* base = mmap(NULL, length + extra, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        return NULL;
+    }
+    uint8_t* ptr = base;
+    if (extra != 0) {
+        ptr = (uint8_t*)(((uintptr_t)base + alignment - 1) & ~(uintptr_t)(alignment - 1));
+        if (ptr != base) {
+            munmap(base, ptr - base);
+        }
+        if (ptr + length != base + length + extra) {
+            munmap(ptr + length, base + length + extra - (ptr + length));
+        }
+    }
+
+    if (!mapping_add(ptr, length)) {
+        munmap(ptr, length);
+        return NULL;
+    }
+    return ptr;
+}
+
+/*
+ * Fork handlers. Every allocator lock is held across fork, so no other
+ * thread can be inside the allocator when the child is copied, and the
+ * child, whose other threads are gone, starts with all of them free.
+ * Returns: No return value.
+ */
+static void shim_fork_prepare(void)
+{
+    pthread_mutex_lock(&g_mapping_lock);
+    pool_lock_all(g_shim_pool);
+}
+
+static void shim_fork_parent(void)
+{
+    pool_unlock_all(g_shim_pool, false);
+    pthread_mutex_unlock(&g_mapping_lock);
+}
+
+static void shim_fork_child(void)
+{
+    pool_unlock_all(g_shim_pool, true);
+    pthread_mutex_init(&g_mapping_lock, NULL);
+}
+
+/*
+ * This function creates the pool instance, once per process.
+ * Returns: No return value.
+ */
+static void shim_init(void)
+{
+    pool_config config = {.block_sizes = g_shim_sizes, .block_size_count = SHIM_CLASSES,
+                          .heap_size = SHIM_CLASSES * SHIM_CHUNK, .chunk_size = SHIM_CHUNK,
+                          .grow_limit = SHIM_GROW_LIMIT};
+    pool_t* pool = pool_create(&config);
+    if (pool != NULL && pthread_atfork(shim_fork_prepare, shim_fork_parent, shim_fork_child) != 0) {
+        pool_destroy(pool);
+        pool = NULL; // without the handlers a fork could inherit a held lock
+    }
+    g_shim_pool = pool;
+}
+
+/*
+ * This function returns the pool instance for a top-level call. Calls
+ * made by the allocator itself, or any call before the instance exists,
+ * get NULL and are served by mappings.
+ * Returns: Pointer to the instance, NULL if it must not be used
+ */
+static pool_t* shim_enter(void)
+{
+    if (t_shim_depth++ != 0) {
+        return NULL;
+    }
+    pthread_once(&g_shim_once, shim_init);
+    return g_shim_pool;
+}
+
+static void shim_leave(void)
+{
+    t_shim_depth--;
+}
+
+/*
+ * This function allocates n bytes at a multiple of alignment from the pool
+ * when a size class fits, else from a mapping.
+ * Returns: Pointer to allocated memory, NULL with errno set if it failed
+ */
+static void* shim_alloc(size_t n, size_t alignment, bool zeroed)
+{
+    void* ptr = NULL;
+    if (n == 0) {
+        n = 1; // every call returns a distinct pointer
+    }
+
+    pool_t* pool = shim_enter();
+    if (pool != NULL && n <= SHIM_LARGEST && alignment <= SHIM_ALIGNMENT) {
+        if (alignment > 16) {
+            ptr = pool_aligned_alloc_in(pool, alignment, n);
+        }
+        else {
+            ptr = zeroed ? pool_calloc_in(pool, 1, n) : pool_malloc_in(pool, n);
+        }
+    }
+    if (ptr == NULL) {
+        ptr = map_alloc(n, alignment); // mappings are always zero
+    }
+    shim_leave();
+
+    if (ptr == NULL) {
+        errno = ENOMEM;
+    }
+    return ptr;
+}
+
+/*
+ * This function reports the usable size of a block from either source.
+ * Returns: Usable size, 0 if ptr was not handed out by this allocator
+ */
+static size_t shim_usable_size(void* ptr)
+{
+    size_t size = g_shim_pool != NULL ? pool_usable_size_in(g_shim_pool, ptr) : 0;
+    return size != 0 ? size : mapping_lookup(ptr, false);
+}
+
+SHIM_EXPORT void* malloc(size_t n)
+{
+    return shim_alloc(n, 16, false);
+}
+
+SHIM_EXPORT void* calloc(size_t count, size_t size)
+{
+    if (size != 0 && count > SIZE_MAX / size) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return shim_alloc(count * size, 16, true);
+}
+
+SHIM_EXPORT void free(void* ptr)
+{
+    if (ptr == NULL) {
+        return;
+    }
+
+    // pool blocks are found by address range, mappings by the table,
+    // and anything else is left alone
+    t_shim_depth++;
+    bool released = g_shim_pool != NULL && pool_try_free_in(g_shim_pool, ptr);
+    t_shim_depth--;
+    if (released) {
+        return;
+    }
+    size_t length = mapping_lookup(ptr, true);
+    if (length != 0) {
+        munmap(ptr, length);
+    }
+}
+
+SHIM_EXPORT void* realloc(void* ptr, size_t n)
+{
+    if (ptr == NULL) {
+        return malloc(n);
+    }
+    if (n == 0) {
+        free(ptr);
+        return NULL;
+    }
+
+    size_t old_size = shim_usable_size(ptr);
+    if (old_size == 0) {
+        errno = ENOMEM;
+        return NULL; // not ours, its size is unknown
+    }
+    if (n <= old_size) {
+        return ptr;
+    }
+
+    void* moved = malloc(n);
+    if (moved != NULL) {
+        memcpy(moved, ptr, old_size);
+        free(ptr);
+    }
+    return moved;
+}
+
+SHIM_EXPORT int posix_memalign(void** memptr, size_t alignment, size_t n)
+{
+    if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0) {
+        return EINVAL;
+    }
+    void* ptr = shim_alloc(n, alignment, false);
+    if (ptr == NULL) {
+        return ENOMEM;
+    }
+    *memptr = ptr;
+    return 0;
+}
+
+SHIM_EXPORT void* aligned_alloc(size_t alignment, size_t n)
+{
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return shim_alloc(n, alignment, false);
+}
+
+SHIM_EXPORT void* memalign(size_t alignment, size_t n)
+{
+    return aligned_alloc(alignment, n);
+}
+
+SHIM_EXPORT void* valloc(size_t n)
+{
+    return shim_alloc(n, SHIM_PAGE, false);
+}
+
+SHIM_EXPORT size_t malloc_usable_size(void* ptr)
+{
+    return ptr != NULL ? shim_usable_size(ptr) : 0;
+}
@@ -0,0 +1,197 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench_util.h"
+
+/*
+* Replays an allocation trace recorded with pool_trace_start against a pool
+* instance and against the system malloc, as fast as possible, and reports
+* the time each took. The pool instance uses the block sizes given with -b,
+* by default powers of two from 16 to 65536 bytes, and grows on demand so
+* the heap size of the recording does not matter. Allocations no pool can
+* hold are counted as failures and their frees skipped.
+*
+* Record a trace from a build with -DPOOL_TRACE, then build the replay with
+* `gcc -O2 replay.c pool_alloc.c -o replay` and run `./replay trace [-b 32,64,256]`.
+*/
+
+#define MAX_SIZES 32 // matches the pool limit of pool_alloc.c
+
+/*
+ * This function reads every event of a trace file into memory.
+ * Returns: Array of events, NULL if the file is unreadable or not a trace
+ */
+static pool_trace_event* load_trace(const char* path, size_t* count)
+{
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+
+    pool_trace_header header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != POOL_TRACE_MAGIC
+        || header.version != POOL_TRACE_VERSION) {
+        fclose(file);
+        return NULL;
+    }
+
+    size_t capacity = 4096;
+    size_t used = 0;
+    pool_trace_event* events = malloc(capacity * sizeof(pool_trace_event));
+    while (events != NULL) {
+        used += fread(events + used, sizeof(pool_trace_event), capacity - used, file);
+        if (used < capacity) {
+            break;
+        }
+        pool_trace_event* grown = realloc(events, capacity * 2 * sizeof(pool_trace_event));
+        if (grown == NULL) {
+            free(events);
+        }
+        events = grown;
+        capacity *= 2;
+    }
+    fclose(file);
+
+    *count = used;
+    return events;
+}
+
+/*
+ * This function re-executes every event against one allocator and prints
+ * the time taken. Blocks still live at the end of the trace are freed
+ * outside the timed section.
+ * Returns: No return value.
+ */
+static void replay(const char* name, void* (*alloc)(void*, size_t), void (*release)(void*, void*),
+                   void* ctx, const pool_trace_event* events, size_t count, void** live)
+{
+    size_t failed = 0;
+
+    uint64_t start = now_ns();
+    for (size_t i = 0; i < count; ++i) {
+        const pool_trace_event* event = &events[i];
+        if (event->op == POOL_TRACE_MALLOC) {
+            live[event->id] = alloc(ctx, event->size);
+            if (live[event->id] == NULL) {
+                failed++;
+            }
+            else {
+                *(volatile uint8_t*)live[event->id] = 1;
+            }
+        }
+        else if (live[event->id] != NULL) {
+            release(ctx, live[event->id]);
+            live[event->id] = NULL;
+        }
+    }
+    uint64_t elapsed = now_ns() - start;
+
+    for (size_t i = 0; i < count; ++i) {
+        if (events[i].op == POOL_TRACE_MALLOC && live[events[i].id] != NULL) {
+            release(ctx, live[events[i].id]);
+            live[events[i].id] = NULL;
+        }
+    }
+
+    printf("%-7s %12llu %10.2f %10zu\n", name, (unsigned long long)elapsed,
+           ns_per_op(elapsed, count), failed);
+}
+
+int main(int argc, char** argv)
+{
+    size_t block_sizes[MAX_SIZES];
+    size_t block_size_count = 0;
+    const char* path = NULL;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            char* list = argv[++i];
+            while (*list != '\0' && block_size_count < MAX_SIZES) {
+                block_sizes[block_size_count++] = strtoul(list, &list, 10);
+                list += *list == ',';
+            }
+        }
+        else {
+            path = argv[i];
+        }
+    }
+    if (path == NULL) {
+        fprintf(stderr, "usage: %s trace [-b size,size,...]\n", argv[0]);
+        return 1;
+    }
+    if (block_size_count == 0) {
+        for (size_t size = 16; size <= 65536; size *= 2) {
+            block_sizes[block_size_count++] = size;
+        }
+    }
+
+    size_t count = 0;
+    pool_trace_event* events = load_trace(path, &count);
+    if (events == NULL) {
+        fprintf(stderr, "Err: %s is not a readable trace\n", path);
+        return 1;
+    }
+
+    // ids are numbered from 1 in allocation order, so they index an array
+    uint32_t max_id = 0;
+    uint64_t live_bytes = 0;
+    uint64_t peak_bytes = 0;
+    size_t allocs = 0;
+    uint64_t* sizes = NULL;
+    for (size_t i = 0; i < count; ++i) {
+        if (events[i].id > max_id) {
+            max_id = events[i].id;
+        }
+    }
+    sizes = calloc((size_t)max_id + 1, sizeof(uint64_t));
+    void** live = calloc((size_t)max_id + 1, sizeof(void*));
+    if (sizes == NULL || live == NULL) {
+        fprintf(stderr, "Err: Out of memory\n");
+        return 1;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (events[i].op == POOL_TRACE_MALLOC) {
+            sizes[events[i].id] = events[i].size;
+            live_bytes += events[i].size;
+            allocs++;
+            if (live_bytes > peak_bytes) {
+                peak_bytes = live_bytes;
+            }
+        }
+        else {
+            live_bytes -= sizes[events[i].id];
+            sizes[events[i].id] = 0;
+        }
+    }
+    printf("%zu events, %zu allocations, peak %llu bytes requested\n", count, allocs,
+           (unsigned long long)peak_bytes);
+
+    size_t largest = 0;
+    for (size_t i = 0; i < block_size_count; ++i) {
+        largest = block_sizes[i] > largest ? block_sizes[i] : largest;
+    }
+    size_t chunk_size = 65536;
+    while (chunk_size < largest) {
+        chunk_size *= 2;
+    }
+    pool_config config = {.block_sizes = block_sizes, .block_size_count = block_size_count,
+                          .heap_size = block_size_count * chunk_size, .chunk_size = chunk_size,
+                          .grow_limit = (size_t)16 << 30};
+    pool_t* pool = pool_create(&config);
+    if (pool == NULL) {
+        fprintf(stderr, "Err: Could not create a pool with those block sizes\n");
+        return 1;
+    }
+
+    printf("%-7s %12s %10s %10s\n", "backend", "ns", "ns/event", "failed");
+    replay("pool", pool_alloc_fn, pool_release_fn, pool, events, count, live);
+    replay("malloc", malloc_fn, free_fn, NULL, events, count, live);
+
+    pool_destroy(pool);
+    free(live);
+    free(sizes);
+    free(events);
+    return 0;
+}
@@ -0,0 +1,13 @@
+#ifndef STATIC_POOLS_H
+#define STATIC_POOLS_H
+
+// Example compile-time layout of the default instance, one
+// X(block_size, block_count) per pool in ascending block size order.
+// Build with -DPOOL_STATIC_CONFIG='"static_pools.h"'.
+#define POOL_STATIC_POOLS(X) \
+    X(32, 512)               \
+    X(64, 256)               \
+    X(256, 64)               \
+    X(1024, 16)
+
+#endif // STATIC_POOLS_H